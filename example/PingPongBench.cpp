@@ -0,0 +1,416 @@
+/**
+ * @file PingPongBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 端到端的ping-pong吞吐量测试，按线程数、会话数、块大小扫描
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 与muduo的pingpong测试相同：每个会话连接后发送一个块，服务器原样回显，
+ * 客户端收到多少就原样发回多少，持续-T秒。吞吐量按客户端收到的字节数计算，
+ * 每block字节计为一条消息。
+ * 默认在本进程中启动回显服务器，客户端和服务器使用相同的线程数；
+ * -x连接外部的回显服务器(用于和其他库对比)，-L只运行服务器
+ *
+ */
+#include "Config.h"
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/NetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace neonet;
+
+namespace {
+inline constexpr const int kCloseWaitRounds{500}; // 等待关闭的轮数，每轮10ms
+
+/**
+ * @brief 命令行参数
+ *
+ */
+struct Options {
+  const char *ip{"127.0.0.1"};
+  int port{PORT};
+  std::vector<size_t> threads{1, 2, 4};
+  std::vector<size_t> sessions{1, 10, 100};
+  std::vector<size_t> blocks{4096, 65536, 1024 * 1024};
+  double duration{2.0}; // 每个组合运行的秒数
+  bool edgeTriggered{false};
+  bool mirrored{false};   // 输入缓冲使用环形存储
+  bool external{false};   // 使用外部服务器
+  bool serverOnly{false}; // 只运行服务器
+};
+
+int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief 原样发回buf中的数据；环形输入缓冲在发送之后应当仍是环形的
+ *
+ */
+void echo(const TcpConnectionPtr &conn, Buffer *buf) {
+  const bool mirrored = buf->mirrored();
+  conn->send(buf);
+  if (mirrored && !buf->mirrored()) {
+    LOG_FATAL << conn->name() << ": send took the ring input buffer";
+  }
+}
+
+/**
+ * @brief 在loop线程中执行cb并等待其完成
+ *
+ */
+void runAndWait(EventLoop *loop, const std::function<void()> &cb) {
+  std::promise<void> done;
+  loop->runInLoop([&cb, &done]() {
+    cb();
+    done.set_value();
+  });
+  done.get_future().wait();
+}
+
+/**
+ * @brief 解析逗号分隔的正整数列表
+ *
+ */
+std::vector<size_t> parseList(const char *arg) {
+  std::vector<size_t> values;
+  char *end = nullptr;
+  for (const char *p = arg; *p != '\0'; p = (*end == ',') ? end + 1 : end) {
+    size_t value = std::strtoull(p, &end, 10);
+    if (end == p || value == 0) {
+      return {};
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+/**
+ * @brief 在独立的EventLoop线程中运行的回显服务器
+ *
+ */
+class EchoServer {
+public:
+  EchoServer(const Options &options, size_t threads)
+      : m_loop(m_thread.startLoop()) {
+    runAndWait(m_loop, [this, &options, threads]() {
+      m_server.reset(new TcpServer(
+          m_loop, NetAddress(options.ip, options.port), "PingPongServer"));
+      m_server->setThreadNum(static_cast<int>(threads));
+      m_server->setEdgeTriggered(options.edgeTriggered);
+      m_server->setConnectionCallback(
+          [mirrored = options.mirrored](const TcpConnectionPtr &conn) {
+            if (conn->connected()) {
+              conn->setTcpNoDelay(true);
+              if (mirrored) {
+                conn->setMirroredInputBuffer();
+              }
+            }
+          });
+      m_server->setMessageCallback(
+          [](const TcpConnectionPtr &conn, Buffer *buf) { echo(conn, buf); });
+      m_server->start();
+    });
+  }
+  ~EchoServer() {
+    runAndWait(m_loop, [this]() { m_server.reset(); });
+  }
+
+private:
+  EventLoopThread m_thread;
+  EventLoop *m_loop;
+  std::unique_ptr<TcpServer> m_server; // 只在m_loop中访问
+};
+
+class Session;
+
+/**
+ * @brief 一个客户端I/O线程及其上的会话
+ *
+ */
+struct LoopContext {
+  EventLoop *loop{nullptr};
+  std::atomic<size_t> *liveSessions{nullptr}; // 所有loop上仍然连接着的会话数
+  std::vector<std::unique_ptr<Session>> sessions{};
+  uint64_t bytesRead{0};
+};
+
+/**
+ * @brief 一个客户端连接，收到多少发回多少
+ *
+ */
+class Session {
+public:
+  Session(LoopContext *context, const Options &options,
+          const NetAddress &serverAddr, const std::string &name,
+          std::function<void()> onConnected)
+      : m_context(context), m_client(context->loop, serverAddr, name),
+        m_onConnected(std::move(onConnected)) {
+    m_client.setEdgeTriggered(options.edgeTriggered);
+    m_client.setConnectionCallback([this, mirrored = options.mirrored](
+                                       const TcpConnectionPtr &conn) {
+      if (conn->connected()) {
+        conn->setTcpNoDelay(true);
+        if (mirrored) {
+          conn->setMirroredInputBuffer();
+        }
+        m_connection = conn;
+        m_context->liveSessions->fetch_add(1);
+        m_onConnected();
+      } else if (m_connection) {
+        m_connection.reset();
+        m_context->liveSessions->fetch_sub(1);
+      }
+    });
+    m_client.setMessageCallback(
+        [this](const TcpConnectionPtr &conn, Buffer *buf) {
+          if (m_stopping) {
+            buf->retrieveAll();
+            return;
+          }
+          m_context->bytesRead += buf->readableBytes();
+          echo(conn, buf);
+        });
+  }
+
+  void connect() { m_client.connect(); }
+  /**
+   * @brief 发出第一个块，在所属loop中调用
+   *
+   */
+  void start(const std::string &block) {
+    if (m_connection) {
+      m_connection->send(block.data(), static_cast<int>(block.size()));
+    }
+  }
+  /**
+   * @brief 停止回显并半关闭，服务器读到EOF后关闭连接，避免对端写入时收到RST
+   *
+   */
+  void stop() {
+    m_stopping = true;
+    if (m_connection) {
+      m_connection->shutdown();
+    }
+  }
+  void close() {
+    if (m_connection) {
+      m_connection->forceClose();
+    }
+  }
+
+private:
+  LoopContext *m_context;
+  bool m_stopping{false};
+  TcpClient m_client;
+  std::function<void()> m_onConnected;
+  TcpConnectionPtr m_connection;
+};
+
+/**
+ * @brief 运行一个组合，返回客户端每秒收到的字节数
+ *
+ */
+double runOnce(const Options &options, size_t threads, size_t sessions,
+               size_t blockSize) {
+  EventLoop loop;
+  EventLoopThreadPool pool(&loop, "PingPongClient");
+  pool.setThreadNum(static_cast<int>(threads));
+  pool.start();
+
+  std::atomic<size_t> liveSessions{0};
+  std::vector<std::unique_ptr<LoopContext>> contexts;
+  for (EventLoop *ioLoop : pool.getAllLoops()) {
+    contexts.emplace_back(new LoopContext{ioLoop, &liveSessions});
+  }
+
+  const std::string block(blockSize, 'x');
+  NetAddress serverAddr(options.ip, options.port);
+  std::atomic<size_t> connected{0};
+  int64_t startTime = 0;
+  auto startSending = [&]() {
+    startTime = nowNanos();
+    for (auto &context : contexts) {
+      LoopContext *ctx = context.get();
+      ctx->loop->runInLoop([ctx, &block]() {
+        for (auto &session : ctx->sessions) {
+          session->start(block);
+        }
+      });
+    }
+    loop.runAfter(options.duration, [&loop]() { loop.quit(); });
+  };
+  auto onConnected = [&]() {
+    if (connected.fetch_add(1) + 1 == sessions) {
+      loop.runInLoop(startSending);
+    }
+  };
+
+  for (size_t i = 0; i < sessions; ++i) {
+    LoopContext *ctx = contexts[i % contexts.size()].get();
+    std::unique_ptr<Session> session(
+        new Session(ctx, options, serverAddr,
+                    "PingPongClient-" + std::to_string(i), onConnected));
+    Session *s = session.get();
+    runAndWait(ctx->loop, [ctx, &session]() {
+      ctx->sessions.push_back(std::move(session));
+    });
+    s->connect();
+  }
+  loop.loop();
+
+  double elapsed = static_cast<double>(nowNanos() - startTime) / 1e9;
+  uint64_t bytes = 0;
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx, &bytes]() { bytes += ctx->bytesRead; });
+  }
+
+  // 先半关闭所有连接，等服务器关闭；超时后强制关闭剩下的
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx]() {
+      for (auto &session : ctx->sessions) {
+        session->stop();
+      }
+    });
+  }
+  for (int i = 0; i < kCloseWaitRounds && liveSessions.load() > 0; ++i) {
+    ::usleep(10 * 1000);
+  }
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx]() {
+      for (auto &session : ctx->sessions) {
+        session->close();
+      }
+    });
+  }
+  // 等关闭和销毁都执行完再释放客户端
+  auto drain = [&contexts]() {
+    for (int round = 0; round < 2; ++round) {
+      for (auto &context : contexts) {
+        runAndWait(context->loop, []() {});
+      }
+    }
+  };
+  drain();
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx]() { ctx->sessions.clear(); });
+  }
+  drain();
+  return static_cast<double>(bytes) / elapsed;
+}
+
+void usage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options]\n"
+            << "  -i ip        server address (default 127.0.0.1)\n"
+            << "  -p port      server port (default " << PORT << ")\n"
+            << "  -t list      thread counts (default 1,2,4)\n"
+            << "  -c list      concurrent sessions (default 1,10,100)\n"
+            << "  -b list      block sizes in bytes "
+               "(default 4096,65536,1048576)\n"
+            << "  -T seconds   duration of each run (default 2)\n"
+            << "  -e           edge-triggered connections\n"
+            << "  -m           mirrored ring input buffers\n"
+            << "  -x           use an external echo server at ip:port\n"
+            << "  -L           run only the echo server with the first "
+               "thread count\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  int opt;
+  while ((opt = ::getopt(argc, argv, "i:p:t:c:b:T:emxLh")) != -1) {
+    switch (opt) {
+    case 'i':
+      options.ip = optarg;
+      break;
+    case 'p':
+      options.port = std::atoi(optarg);
+      break;
+    case 't':
+      options.threads = parseList(optarg);
+      break;
+    case 'c':
+      options.sessions = parseList(optarg);
+      break;
+    case 'b':
+      options.blocks = parseList(optarg);
+      break;
+    case 'T':
+      options.duration = std::atof(optarg);
+      break;
+    case 'e':
+      options.edgeTriggered = true;
+      break;
+    case 'm':
+      options.mirrored = true;
+      break;
+    case 'x':
+      options.external = true;
+      break;
+    case 'L':
+      options.serverOnly = true;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (options.threads.empty() || options.sessions.empty() ||
+      options.blocks.empty() || options.duration <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (options.serverOnly) {
+    EchoServer server(options, options.threads.front());
+    LOG_INFO << "PingPong echo server listening on " << options.ip << ":"
+             << options.port;
+    for (;;) {
+      ::pause();
+    }
+  }
+
+  std::printf("%8s %9s %12s %12s %14s\n", "threads", "sessions", "block",
+              "MiB/s", "messages/s");
+  for (size_t threads : options.threads) {
+    std::unique_ptr<EchoServer> server;
+    if (!options.external) {
+      server.reset(new EchoServer(options, threads));
+    }
+    for (size_t sessions : options.sessions) {
+      for (size_t block : options.blocks) {
+        double bytesPerSecond = runOnce(options, threads, sessions, block);
+        std::printf("%8zu %9zu %12zu %12.2f %14.0f\n", threads, sessions,
+                    block, bytesPerSecond / (1024 * 1024),
+                    bytesPerSecond / static_cast<double>(block));
+        std::fflush(stdout);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,459 @@
+/**
+ * @file PressureGenerator.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief RelayServer的压力发生器：统计转发往返的吞吐量和延迟分位数
+ * @version 0.1
+ * @date 2024-08-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 在M个EventLoop线程上建立N个连接，服务器按连接顺序两两配对。
+ * 每个连接发送cmd=1的请求，报文体开头是发送时间；收到对端转发来的请求后
+ * 原样改为cmd=2发回，请求方收到cmd=2时得到一次往返的延迟
+ * (请求方->服务器->对端->服务器->请求方)。
+ * - -d限制每个连接在途的请求数(流水线深度)
+ * - -R限制每个连接每秒发送的请求数，0表示只受深度限制
+ *
+ */
+#include "Config.h"
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/NetAddress.h"
+#include "net/TcpClient.h"
+#include "protocol/FrameDecoder.h"
+#include "tools/Bytetransform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace neonet;
+
+namespace {
+inline constexpr const size_t kHeaderSize{FrameDecoder::kHeaderSize};
+inline constexpr const uint32_t kRequest{1};
+inline constexpr const uint32_t kResponse{2};
+inline constexpr const double kTick{0.001}; // 限速时补充额度的间隔，秒
+
+struct Options {
+  const char *ip{"127.0.0.1"};
+  int port{PORT};
+  int connections{100};
+  int threads{4};
+  size_t messageSize{1024}; // 报文体字节数，至少容纳时间戳
+  double rate{0};           // 每个连接每秒的请求数，0表示不限速
+  int depth{1};             // 每个连接在途的请求数上限
+  double duration{10};      // 秒
+  bool edgeTriggered{false};
+};
+
+int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief 对数-线性直方图，相对误差不超过1/64
+ *
+ * @details 小于64的值各占一个桶；之后每个2的幂区间再等分为64个桶
+ */
+class Histogram {
+public:
+  void record(uint64_t value) {
+    ++m_counts[bucketOf(value)];
+    ++m_total;
+  }
+  void merge(const Histogram &rhs) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+      m_counts[i] += rhs.m_counts[i];
+    }
+    m_total += rhs.m_total;
+  }
+  uint64_t total() const { return m_total; }
+  /**
+   * @brief 第p分位数(0 < p <= 1)所在桶的下界
+   *
+   */
+  uint64_t percentile(double p) const {
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(m_total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      seen += m_counts[i];
+      if (seen > rank) {
+        return valueOf(i);
+      }
+    }
+    return m_total == 0 ? 0 : valueOf(kBuckets - 1);
+  }
+
+private:
+  inline static constexpr const int kSubBits{6};
+  inline static constexpr const uint64_t kSub{1 << kSubBits};
+  inline static constexpr const size_t kBuckets{(64 - kSubBits + 1) * kSub};
+
+  static size_t bucketOf(uint64_t v) {
+    if (v < kSub) {
+      return v;
+    }
+    int shift = 63 - __builtin_clzll(v) - kSubBits;
+    return (shift + 1) * kSub + ((v >> shift) - kSub);
+  }
+  static uint64_t valueOf(size_t index) {
+    if (index < kSub) {
+      return index;
+    }
+    int shift = static_cast<int>(index / kSub) - 1;
+    return (index % kSub + kSub) << shift;
+  }
+
+  std::vector<uint64_t> m_counts = std::vector<uint64_t>(kBuckets);
+  uint64_t m_total{0};
+};
+
+/**
+ * @brief 一个loop上所有连接的统计，只在该loop中访问
+ *
+ */
+struct ClientStats {
+  uint64_t requests{0};  // 发出的请求数
+  uint64_t responses{0}; // 收到的响应数，即完成的往返数
+  uint64_t bytes{0};     // 收到的报文字节数(含报头)
+  Histogram latency;     // 往返延迟，纳秒
+};
+
+class Session;
+
+/**
+ * @brief 一个I/O线程及其上的连接
+ *
+ */
+struct LoopContext {
+  EventLoop *loop{nullptr};
+  std::vector<std::unique_ptr<Session>> sessions{};
+  ClientStats stats{};
+  bool sending{false};
+  TimerId refillTimer{}; // 限速时补充额度的定时器
+};
+
+/**
+ * @brief 一个客户端连接及其流量控制状态
+ *
+ */
+class Session {
+public:
+  Session(LoopContext *context, const Options &options,
+          const NetAddress &serverAddr, const std::string &name,
+          std::function<void()> onConnected)
+      : m_context(context), m_options(options),
+        m_client(context->loop, serverAddr, name),
+        m_onConnected(std::move(onConnected)),
+        m_decoder(
+            [this](const TcpConnectionPtr &conn, const FrameBatch &frames) {
+              onFrames(conn, frames);
+            },
+            static_cast<uint32_t>(options.messageSize)) {
+    // 请求模板，发送时只改写报文体开头的时间戳
+    neonet::Header header;
+    header.cmd = socket::hostToNetwork32(kRequest);
+    header.length =
+        socket::hostToNetwork32(static_cast<uint32_t>(options.messageSize));
+    m_request.resize(kHeaderSize + options.messageSize, 'x');
+    ::memcpy(&m_request[0], &header, kHeaderSize);
+
+    m_client.setEdgeTriggered(options.edgeTriggered);
+    m_client.setConnectionCallback([this](const TcpConnectionPtr &conn) {
+      if (conn->connected()) {
+        conn->setTcpNoDelay(true);
+        m_connection = conn;
+        m_onConnected();
+      } else {
+        m_connection.reset();
+        if (m_context->sending) {
+          LOG_WARN << conn->name() << " lost during the test";
+        }
+      }
+    });
+    m_client.setMessageCallback(
+        [this](const TcpConnectionPtr &conn, Buffer *buf) {
+          m_decoder.onMessage(conn, buf);
+        });
+  }
+
+  void connect() { m_client.connect(); }
+  /**
+   * @brief 关闭连接，连接回调之后不再访问本对象
+   *
+   */
+  void close() {
+    if (m_connection) {
+      m_connection->forceClose();
+    }
+  }
+
+  /**
+   * @brief 补充限速额度，最多攒下depth个
+   *
+   */
+  void refill() {
+    m_credits = std::min(m_credits + m_options.rate * kTick,
+                         static_cast<double>(m_options.depth));
+    trySend();
+  }
+
+  /**
+   * @brief 在深度和速率允许的范围内发送请求，合并为一次send
+   *
+   */
+  void trySend() {
+    if (!m_context->sending || !m_connection) {
+      return;
+    }
+    Buffer out;
+    while (m_outstanding < m_options.depth &&
+           (m_options.rate <= 0 || m_credits >= 1.0)) {
+      int64_t now = nowNanos();
+      ::memcpy(&m_request[kHeaderSize], &now, sizeof now);
+      out.append(m_request.data(), m_request.size());
+      ++m_outstanding;
+      ++m_context->stats.requests;
+      if (m_options.rate > 0) {
+        m_credits -= 1.0;
+      }
+    }
+    if (out.readableBytes() > 0) {
+      m_connection->send(&out);
+    }
+  }
+
+private:
+  void onFrames(const TcpConnectionPtr &conn, const FrameBatch &frames) {
+    ClientStats &stats = m_context->stats;
+    Buffer responses;
+    for (const Frame &frame : frames) {
+      if (frame.cmd == kRequest) {
+        // 对端的请求：改为响应原样发回
+        uint32_t cmd = socket::hostToNetwork32(kResponse);
+        responses.append(&cmd, sizeof cmd);
+        responses.append(frame.raw() + sizeof cmd,
+                         frame.rawSize() - sizeof cmd);
+      } else if (frame.cmd == kResponse && frame.length >= sizeof(int64_t)) {
+        int64_t sent = 0;
+        ::memcpy(&sent, frame.data, sizeof sent);
+        stats.latency.record(static_cast<uint64_t>(nowNanos() - sent));
+        ++stats.responses;
+        --m_outstanding;
+      }
+    }
+    stats.bytes += frames.bytes();
+    if (responses.readableBytes() > 0) {
+      conn->send(&responses);
+    }
+    trySend();
+  }
+
+  LoopContext *m_context;
+  const Options &m_options;
+  TcpClient m_client;
+  std::function<void()> m_onConnected;
+  FrameDecoder m_decoder;
+  TcpConnectionPtr m_connection;
+  std::string m_request;
+  int m_outstanding{0};
+  double m_credits{0};
+};
+
+/**
+ * @brief 在loop线程中执行cb并等待其完成
+ *
+ */
+void runAndWait(EventLoop *loop, const std::function<void()> &cb) {
+  std::promise<void> done;
+  loop->runInLoop([&cb, &done]() {
+    cb();
+    done.set_value();
+  });
+  done.get_future().wait();
+}
+
+void usage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options]\n"
+            << "  -i ip        server address (default 127.0.0.1)\n"
+            << "  -p port      server port (default " << PORT << ")\n"
+            << "  -c conns     connections, paired by the server (default "
+               "100)\n"
+            << "  -t threads   I/O threads (default 4)\n"
+            << "  -s bytes     message body size (default 1024)\n"
+            << "  -R rate      requests per second per connection, 0 = "
+               "unlimited\n"
+            << "  -d depth     outstanding requests per connection "
+               "(default 1)\n"
+            << "  -T seconds   test duration (default 10)\n"
+            << "  -e           edge-triggered connections\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  int opt;
+  while ((opt = ::getopt(argc, argv, "i:p:c:t:s:R:d:T:eh")) != -1) {
+    switch (opt) {
+    case 'i':
+      options.ip = optarg;
+      break;
+    case 'p':
+      options.port = std::atoi(optarg);
+      break;
+    case 'c':
+      options.connections = std::atoi(optarg);
+      break;
+    case 't':
+      options.threads = std::atoi(optarg);
+      break;
+    case 's':
+      options.messageSize = std::strtoull(optarg, nullptr, 10);
+      break;
+    case 'R':
+      options.rate = std::atof(optarg);
+      break;
+    case 'd':
+      options.depth = std::atoi(optarg);
+      break;
+    case 'T':
+      options.duration = std::atof(optarg);
+      break;
+    case 'e':
+      options.edgeTriggered = true;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (options.connections <= 0 || options.connections % 2 != 0 ||
+      options.threads <= 0 || options.depth <= 0) {
+    std::cout << "connections must be a positive even number, threads and "
+                 "depth must be positive"
+              << std::endl;
+    return 1;
+  }
+  options.messageSize = std::max(options.messageSize, sizeof(int64_t));
+
+  EventLoop loop;
+  EventLoopThreadPool pool(&loop, "PressureGenerator");
+  pool.setThreadNum(options.threads);
+  pool.start();
+
+  std::vector<std::unique_ptr<LoopContext>> contexts;
+  for (EventLoop *ioLoop : pool.getAllLoops()) {
+    contexts.emplace_back(new LoopContext{ioLoop});
+  }
+
+  NetAddress serverAddr(options.ip, options.port);
+  std::atomic<int> connected{0};
+  int64_t startTime = 0;
+  auto startSending = [&]() {
+    startTime = nowNanos();
+    for (auto &context : contexts) {
+      LoopContext *ctx = context.get();
+      ctx->loop->runInLoop([ctx, &options]() {
+        ctx->sending = true;
+        for (auto &session : ctx->sessions) {
+          session->trySend();
+        }
+        if (options.rate > 0) {
+          ctx->refillTimer = ctx->loop->runEvery(kTick, [ctx]() {
+            for (auto &session : ctx->sessions) {
+              session->refill();
+            }
+          });
+        }
+      });
+    }
+    loop.runAfter(options.duration, [&loop]() { loop.quit(); });
+  };
+  auto onConnected = [&]() {
+    if (connected.fetch_add(1) + 1 == options.connections) {
+      // 等服务器把最后一批连接登记好再开始发送
+      loop.runAfter(0.2, startSending);
+    }
+  };
+
+  // 依次建立连接，服务器按连接顺序配对
+  for (int i = 0; i < options.connections; ++i) {
+    LoopContext *ctx = contexts[i % contexts.size()].get();
+    std::unique_ptr<Session> session(
+        new Session(ctx, options, serverAddr,
+                    "PressureGenerator-" + std::to_string(i), onConnected));
+    Session *s = session.get();
+    runAndWait(ctx->loop, [ctx, &session]() {
+      ctx->sessions.push_back(std::move(session));
+    });
+    s->connect();
+  }
+  loop.loop();
+
+  // 停止发送并汇总各loop的统计
+  double elapsed = static_cast<double>(nowNanos() - startTime) / 1e9;
+  ClientStats total;
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx, &total]() {
+      ctx->sending = false;
+      ctx->loop->cancel(ctx->refillTimer);
+      total.requests += ctx->stats.requests;
+      total.responses += ctx->stats.responses;
+      total.bytes += ctx->stats.bytes;
+      total.latency.merge(ctx->stats.latency);
+    });
+  }
+  std::printf("connections %d, threads %d, body %zu bytes, depth %d, "
+              "rate %.0f/s per connection, %.2f s\n",
+              options.connections, options.threads, options.messageSize,
+              options.depth, options.rate, elapsed);
+  std::printf("requests %llu, round trips %llu, %.0f round trips/s, "
+              "%.2f MiB/s received\n",
+              static_cast<unsigned long long>(total.requests),
+              static_cast<unsigned long long>(total.responses),
+              static_cast<double>(total.responses) / elapsed,
+              static_cast<double>(total.bytes) / elapsed / (1024 * 1024));
+  std::printf("latency us: p50 %.1f, p99 %.1f, p999 %.1f\n",
+              static_cast<double>(total.latency.percentile(0.50)) / 1e3,
+              static_cast<double>(total.latency.percentile(0.99)) / 1e3,
+              static_cast<double>(total.latency.percentile(0.999)) / 1e3);
+
+  // 先在各自的loop中关闭连接，等关闭和销毁都执行完再释放客户端
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx]() {
+      for (auto &session : ctx->sessions) {
+        session->close();
+      }
+    });
+  }
+  auto drain = [&contexts]() {
+    for (int round = 0; round < 2; ++round) {
+      for (auto &context : contexts) {
+        runAndWait(context->loop, []() {});
+      }
+    }
+  };
+  drain();
+  for (auto &context : contexts) {
+    LoopContext *ctx = context.get();
+    runAndWait(ctx->loop, [ctx]() { ctx->sessions.clear(); });
+  }
+  drain();
+  return 0;
+}
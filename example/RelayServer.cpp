@@ -0,0 +1,320 @@
+/**
+ * @file RelayServer.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 多线程转发服务器：客户端两两配对，编号为id的客户端发来的报文
+ * 转发给编号为GetDstId(id)的客户端
+ * @version 0.1
+ * @date 2024-08-03
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 报文格式为Header{cmd, length}(网络字节序)加length字节的报文体。
+ * 客户端的编号按连接建立的顺序分配，从0开始。
+ * - 默认模式下由FrameDecoder分帧，一次读取中所有完整的报文合并为一次send
+ * - -s开启splice模式，只在用户空间解析报头，报文体经由管道在内核中转发
+ * 对端的输出缓冲超过高水位时暂停读取发送方，降到低水位之后恢复
+ *
+ */
+#include "Config.h"
+#include "base/AsyncLogging.h"
+#include "base/Logging.h"
+#include "net/Backpressure.h"
+#include "net/BufferPool.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/LoopWatchdog.h"
+#include "net/NetAddress.h"
+#include "net/TcpServer.h"
+#include "protocol/FrameDecoder.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+using namespace neonet;
+
+namespace {
+inline constexpr const size_t kHeaderSize{FrameDecoder::kHeaderSize};
+inline constexpr const size_t kLogRollSize{500 * 1024 * 1024};
+
+/**
+ * @brief 命令行参数
+ *
+ */
+struct Options {
+  const char *ip{"0.0.0.0"};
+  int port{PORT};
+  int threads{4};                        // 工作线程数
+  size_t highWaterMark{4 * 1024 * 1024}; // 对端输出缓冲的高水位
+  size_t lowWaterMark{0}; // 恢复发送方读取的低水位，0表示高水位的1/4
+  uint32_t maxMessage{FrameDecoder::kDefaultMaxLength}; // 报文体最大长度
+  const char *logBasename{nullptr}; // 日志文件名前缀，为空时输出到stdout
+  double statsInterval{0.0}; // 每隔多少秒输出各loop的统计，0表示不输出
+  double slowCallback{0.0};  // 慢回调和loop停顿的阈值(秒)，0表示不检测
+  size_t bufferMemory{0};    // 连接缓冲区的全局内存上限，0表示不限
+  bool splice{false};
+  bool edgeTriggered{false};
+  bool reusePort{false};
+};
+
+class RelayServer {
+public:
+  RelayServer(EventLoop *loop, const Options &options)
+      : m_options(options),
+        m_backpressure(options.highWaterMark,
+                       options.lowWaterMark != 0 ? options.lowWaterMark
+                                                 : options.highWaterMark / 4,
+                       [this](const TcpConnectionPtr &conn) {
+                         return findPeer(sessionOf(conn));
+                       }),
+        m_decoder(
+            [this](const TcpConnectionPtr &conn, const FrameBatch &frames) {
+              onFrames(conn, frames);
+            },
+            options.maxMessage),
+        m_server(loop, NetAddress(options.ip, options.port), "RelayServer",
+                 options.reusePort ? TcpServer::kReusePort
+                                   : TcpServer::kSingleAcceptor) {
+    m_server.setThreadNum(options.threads);
+    m_server.setEdgeTriggered(options.edgeTriggered);
+    m_server.setConnectionCallback(
+        [this](const TcpConnectionPtr &conn) { onConnection(conn); });
+    m_server.setMessageCallback(
+        [this](const TcpConnectionPtr &conn, Buffer *buf) {
+          onMessage(conn, buf);
+        });
+  }
+
+  void start() {
+    m_server.start();
+    if (m_options.statsInterval > 0) {
+      m_loops = m_server.threadPool()->getAllLoops();
+      for (EventLoop *ioLoop : m_loops) {
+        m_lastStats.push_back(ioLoop->stats().snapshot());
+      }
+      m_server.getLoop()->runEvery(m_options.statsInterval,
+                                   [this]() { logStats(); });
+    }
+    if (m_options.slowCallback > 0) {
+      m_watchdog.reset(new LoopWatchdog(m_options.slowCallback));
+      for (EventLoop *ioLoop : m_server.threadPool()->getAllLoops()) {
+        ioLoop->setSlowCallbackThreshold(m_options.slowCallback);
+        m_watchdog->watch(ioLoop);
+      }
+      m_watchdog->start();
+    }
+  }
+
+private:
+  /**
+   * @brief 每个连接的状态，作为连接的context，只在连接所属的loop中访问
+   *
+   */
+  struct Session {
+    uint32_t id;
+    std::weak_ptr<TCPConnection> peer; // 对端连接的缓存
+  };
+  using SessionPtr = std::shared_ptr<Session>;
+
+  static Session *sessionOf(const TcpConnectionPtr &conn) {
+    return std::any_cast<SessionPtr>(conn->getContext()).get();
+  }
+
+  void onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      SessionPtr session = std::make_shared<Session>();
+      session->id = m_nextId.fetch_add(1);
+      conn->setContext(session);
+      conn->setTcpNoDelay(true);
+      m_backpressure.attach(conn);
+      if (m_options.splice) {
+        conn->setSpliceHeaderLength(kHeaderSize);
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_clients[session->id] = conn;
+    } else if (conn->getContext().has_value()) {
+      Session *session = sessionOf(conn);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_clients.erase(session->id);
+    }
+  }
+
+  /**
+   * @brief 查找对端连接，找到后缓存在session中
+   *
+   * @param session
+   * @return TcpConnectionPtr 对端还没有连接或者已经断开时为空
+   */
+  TcpConnectionPtr findPeer(Session *session) {
+    TcpConnectionPtr peer = session->peer.lock();
+    if (peer && !peer->disconnected()) {
+      return peer;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_clients.find(GetDstId(session->id));
+      if (it == m_clients.end()) {
+        return nullptr;
+      }
+      peer = it->second.lock();
+    }
+    session->peer = peer;
+    return peer;
+  }
+
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf) {
+    if (!m_options.splice) {
+      m_decoder.onMessage(conn, buf);
+      return;
+    }
+    // splice模式下每次回调恰好是一个报头，报文体由连接转发
+    neonet::Header header = FrameDecoder::peekHeader(buf->peek());
+    if (header.length > m_decoder.maxLength()) {
+      LOG_WARN << "RelayServer: message of " << header.length << " bytes from "
+               << conn->name() << " exceeds the limit, closing";
+      conn->forceClose();
+      return;
+    }
+    TcpConnectionPtr peer = findPeer(sessionOf(conn));
+    if (peer) {
+      peer->send(buf->peek(), static_cast<int>(kHeaderSize));
+    }
+    buf->retrieve(kHeaderSize);
+    conn->spliceTo(peer, header.length);
+  }
+
+  /**
+   * @brief 一次读取中所有完整的报文在输入缓冲区中是连续的，整体转发
+   *
+   */
+  void onFrames(const TcpConnectionPtr &conn, const FrameBatch &frames) {
+    TcpConnectionPtr peer = findPeer(sessionOf(conn));
+    if (peer) {
+      peer->send(frames.data(), static_cast<int>(frames.bytes()));
+    }
+  }
+
+  /**
+   * @brief 输出各I/O线程的loop在上一个周期内的统计
+   *
+   */
+  void logStats() {
+    for (size_t i = 0; i < m_loops.size(); ++i) {
+      LoopStats::Snapshot now = m_loops[i]->stats().snapshot();
+      LOG_INFO << "loop " << i << ": " << (now - m_lastStats[i]).toString()
+               << ", buffers: " << m_loops[i]->bufferPool()->stats().toString();
+      m_lastStats[i] = now;
+    }
+    LOG_INFO << "backpressure: " << m_backpressure.pauses() << " pauses, "
+             << m_backpressure.resumes() << " resumes";
+  }
+
+  const Options m_options;
+  Backpressure m_backpressure; // 对端输出积压时暂停发送方，比连接活得久
+  FrameDecoder m_decoder; // 默认模式的分帧
+  TcpServer m_server;
+  std::atomic<uint32_t> m_nextId{0};
+  std::mutex m_mutex; // 保护m_clients
+  std::unordered_map<uint32_t, std::weak_ptr<TCPConnection>> m_clients;
+  std::vector<EventLoop *> m_loops; // 只在主loop中访问
+  std::vector<LoopStats::Snapshot> m_lastStats;
+  std::unique_ptr<LoopWatchdog> m_watchdog;
+};
+
+void usage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options]\n"
+            << "  -i ip        listen address (default 0.0.0.0)\n"
+            << "  -p port      listen port (default " << PORT << ")\n"
+            << "  -t threads   I/O threads (default 4)\n"
+            << "  -w bytes     peer output high-water mark (default 4MB)\n"
+            << "  -b bytes     low-water mark to resume (default -w / 4)\n"
+            << "  -m bytes     max message body (default "
+            << FrameDecoder::kDefaultMaxLength << ")\n"
+            << "  -s           splice message bodies between sockets\n"
+            << "  -e           edge-triggered connections\n"
+            << "  -r           one SO_REUSEPORT acceptor per I/O thread\n"
+            << "  -l basename  write logs asynchronously to rolling files\n"
+            << "  -S seconds   log per-loop statistics at this interval\n"
+            << "  -W ms        report callbacks and loop stalls over ms\n"
+            << "  -M bytes     cap on connection buffers (default none)\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  int opt;
+  while ((opt = ::getopt(argc, argv, "i:p:t:w:b:m:serl:S:W:M:h")) != -1) {
+    switch (opt) {
+    case 'i':
+      options.ip = optarg;
+      break;
+    case 'p':
+      options.port = std::atoi(optarg);
+      break;
+    case 't':
+      options.threads = std::atoi(optarg);
+      break;
+    case 'w':
+      options.highWaterMark = std::strtoull(optarg, nullptr, 10);
+      break;
+    case 'b':
+      options.lowWaterMark = std::strtoull(optarg, nullptr, 10);
+      break;
+    case 'm':
+      options.maxMessage =
+          static_cast<uint32_t>(std::strtoul(optarg, nullptr, 10));
+      break;
+    case 's':
+      options.splice = true;
+      break;
+    case 'e':
+      options.edgeTriggered = true;
+      break;
+    case 'r':
+      options.reusePort = true;
+      break;
+    case 'l':
+      options.logBasename = optarg;
+      break;
+    case 'S':
+      options.statsInterval = std::atof(optarg);
+      break;
+    case 'W':
+      options.slowCallback = std::atof(optarg) / 1000;
+      break;
+    case 'M':
+      options.bufferMemory = std::strtoull(optarg, nullptr, 10);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (options.lowWaterMark >= options.highWaterMark) {
+    std::cerr << "low-water mark must be below the high-water mark\n";
+    return 1;
+  }
+
+  std::unique_ptr<AsyncLogging> asyncLog;
+  if (options.logBasename != nullptr) {
+    asyncLog.reset(new AsyncLogging(options.logBasename, kLogRollSize));
+    asyncLog->start();
+    asyncLog->install();
+  }
+
+  BufferPool::setMemoryLimit(options.bufferMemory);
+  EventLoop loop;
+  RelayServer server(&loop, options);
+  server.start();
+  LOG_INFO << "RelayServer listening on " << options.ip << ":" << options.port
+           << " with " << options.threads << " threads"
+           << (options.splice ? ", splice" : "");
+  loop.loop();
+  return 0;
+}
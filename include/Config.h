@@ -8,6 +8,8 @@
  * @copyright Copyright (c) 2024
  *
  */
+#ifndef CONFIG_H_
+#define CONFIG_H_
 #include <sys/socket.h>
 struct Header;
 
@@ -19,4 +21,6 @@ struct Header;
 #define MAXCHARS 30001            // 最大字符数 + 1
 #define BACKLOG SOMAXCONN         // listen队列的最大长度
 #define GetDstId(x) (x ^ 0x1)     // 获取目的客户端编号
-#define HEADERSZ (sizeof(Header)) // 头部大小
\ No newline at end of file
+#define HEADERSZ (sizeof(Header)) // 头部大小
+
+#endif // CONFIG_H_
@@ -0,0 +1,134 @@
+/**
+ * @file AsyncLogging.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 异步日志后端：每个线程写自己的缓冲区，后台线程批量写入滚动文件
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * - 前端：每个线程第一次写日志时注册一个ThreadBuffer，写日志只拿这个线程
+ *   自己的锁(只和后端交换缓冲区时竞争)，缓冲区满时交给后端并换一块空闲的
+ * - 后端：每flushInterval秒或者有缓冲区写满时醒来，收走所有写满的缓冲区和
+ *   各线程未满的缓冲区，写入LogFile后刷新；写完的缓冲区回收复用
+ * 后端来不及写时积压超过kMaxBacklog块的部分被丢弃，并在文件中记录丢弃的数量
+ *
+ */
+#ifndef ASYNCLOGGING_H_
+#define ASYNCLOGGING_H_
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+namespace neonet {
+class AsyncLogging {
+public:
+  /**
+   * @param basename 日志文件名前缀，可以带目录
+   * @param rollSize 单个文件的最大字节数
+   * @param flushInterval 后端最长多少秒写一次文件
+   */
+  AsyncLogging(const std::string &basename, size_t rollSize,
+               int flushInterval = 3);
+  ~AsyncLogging();
+  // noncopy
+  AsyncLogging(const AsyncLogging &) = delete;
+  AsyncLogging &operator=(const AsyncLogging &) = delete;
+
+  /**
+   * @brief 前端接口，任意线程调用
+   *
+   * @param msg
+   * @param len
+   */
+  void append(const char *msg, size_t len);
+  /**
+   * @brief 让后端立即写出目前为止的所有日志，最多等待一秒
+   *
+   */
+  void flush();
+
+  void start();
+  /**
+   * @brief 写出剩余的日志并结束后台线程；如果安装为Logger的输出则还原为stdout
+   *
+   */
+  void stop();
+  /**
+   * @brief 将本对象设为Logger的输出，需要在stop之前保持有效
+   *
+   */
+  void install();
+
+private:
+  /**
+   * @brief 一块定长的日志缓冲区
+   *
+   */
+  struct Chunk {
+    Chunk() : data(new char[kChunkSize]) {}
+    size_t avail() const { return kChunkSize - length; }
+    void append(const char *msg, size_t len) {
+      std::copy(msg, msg + len, data.get() + length);
+      length += len;
+    }
+    std::unique_ptr<char[]> data;
+    size_t length{0};
+  };
+  using ChunkPtr = std::unique_ptr<Chunk>;
+  using ChunkVector = std::vector<ChunkPtr>;
+
+  /**
+   * @brief 一个线程的前端缓冲，线程退出后只剩m_threadBuffers持有
+   *
+   */
+  struct ThreadBuffer {
+    std::mutex mutex; // 本线程写日志和后端交换缓冲区之间的锁
+    ChunkPtr current;
+    const AsyncLogging *owner{nullptr};
+  };
+  using ThreadBufferPtr = std::shared_ptr<ThreadBuffer>;
+
+  ThreadBuffer *threadBuffer();
+  /**
+   * @brief 交出写满的缓冲区并取一块空闲的，调用者持有ThreadBuffer的锁
+   *
+   * @param full
+   * @return ChunkPtr
+   */
+  ChunkPtr exchangeFull(ChunkPtr full);
+  void threadFunc();
+  /**
+   * @brief 收走已退出线程的ThreadBuffer中剩余的日志，调用者持有m_mutex
+   *
+   */
+  void reapExitedThreads();
+
+  inline static constexpr const size_t kChunkSize{1024 * 1024};
+  inline static constexpr const size_t kMaxBacklog{25}; // 最多积压的块数
+  inline static constexpr const size_t kMaxFreeChunks{16};
+
+  const std::string m_basename;
+  const size_t m_rollSize;
+  const int m_flushInterval;
+  std::atomic<bool> m_running{false};
+  std::thread m_thread;
+
+  std::mutex m_mutex; // 保护以下成员，在ThreadBuffer的锁之后获取
+  std::condition_variable m_cond;
+  std::condition_variable m_flushedCond;
+  ChunkVector m_fullChunks;
+  ChunkVector m_freeChunks;
+  std::vector<ThreadBufferPtr> m_threadBuffers;
+  uint64_t m_flushRequest{0}; // 请求立即写出的次数
+  uint64_t m_flushed{0};      // 后端已完成的请求数
+};
+} // namespace neonet
+#endif // ASYNCLOGGING_H_
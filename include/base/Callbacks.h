@@ -14,14 +14,18 @@
 #include <memory>
 namespace neonet {
 class Buffer;
-class TcpConnection;
-using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+class TCPConnection;
+using TcpConnectionPtr = std::shared_ptr<TCPConnection>;
 using TimerCallback = std::function<void()>;
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback =
     std::function<void(const TcpConnectionPtr &, size_t)>;
+using LowWaterMarkCallback = std::function<void(const TcpConnectionPtr &)>;
+// sendFile的一块已经写出：(连接, 该区域已发送的字节数, 区域的总字节数)
+using FileProgressCallback =
+    std::function<void(const TcpConnectionPtr &, size_t, size_t)>;
 
 // the data has been read to (buf, len)
 using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *)>;
@@ -0,0 +1,143 @@
+/**
+ * @file InplaceFunction.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定长、只可移动、不分配内存的可调用对象包装
+ * @version 0.1
+ * @date 2024-07-31
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 可调用对象总是存放在对象内部Capacity字节的缓冲区中；捕获的内容放不下时
+ * 编译失败，而不是像std::function那样退化为堆分配。默认容量可以通过
+ * NEONET_INPLACE_FUNCTION_CAPACITY在编译时修改
+ *
+ */
+#ifndef INPLACEFUNCTION_H_
+#define INPLACEFUNCTION_H_
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef NEONET_INPLACE_FUNCTION_CAPACITY
+#define NEONET_INPLACE_FUNCTION_CAPACITY 64 // 默认的内联存储字节数
+#endif
+
+namespace neonet {
+inline constexpr const size_t kInplaceFunctionCapacity{
+    NEONET_INPLACE_FUNCTION_CAPACITY};
+
+template <typename Signature, size_t Capacity = kInplaceFunctionCapacity>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+  InplaceFunction() = default;
+  InplaceFunction(std::nullptr_t) {}
+
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<
+                !std::is_same_v<D, InplaceFunction> &&
+                std::is_invocable_r_v<R, D &, Args...>>>
+  InplaceFunction(F &&f) {
+    static_assert(sizeof(D) <= Capacity,
+                  "callable does not fit in InplaceFunction, shrink the "
+                  "capture or raise the capacity");
+    static_assert(alignof(D) <= alignof(std::max_align_t),
+                  "callable is over-aligned for InplaceFunction");
+    static_assert(std::is_nothrow_move_constructible_v<D>,
+                  "callable in InplaceFunction must be nothrow movable");
+    // 空的std::function或空函数指针得到空的InplaceFunction
+    if constexpr (std::is_constructible_v<bool, const D &>) {
+      if (!static_cast<bool>(f)) {
+        return;
+      }
+    }
+    ::new (static_cast<void *>(m_storage)) D(std::forward<F>(f));
+    m_ops = &Ops<D>::kTable;
+  }
+
+  InplaceFunction(InplaceFunction &&rhs) noexcept { moveFrom(rhs); }
+  InplaceFunction &operator=(InplaceFunction &&rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      moveFrom(rhs);
+    }
+    return *this;
+  }
+  InplaceFunction &operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<
+                !std::is_same_v<D, InplaceFunction> &&
+                std::is_invocable_r_v<R, D &, Args...>>>
+  InplaceFunction &operator=(F &&f) {
+    return *this = InplaceFunction(std::forward<F>(f));
+  }
+
+  // noncopy
+  InplaceFunction(const InplaceFunction &) = delete;
+  InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+  ~InplaceFunction() { reset(); }
+
+  explicit operator bool() const { return m_ops != nullptr; }
+
+  R operator()(Args... args) const {
+    assert(m_ops != nullptr);
+    return m_ops->invoke(const_cast<unsigned char *>(m_storage),
+                         std::forward<Args>(args)...);
+  }
+
+private:
+  /**
+   * @brief 每种可调用类型一张静态操作表，代替虚函数
+   *
+   */
+  struct OpsTable {
+    R (*invoke)(void *, Args &&...);
+    void (*move)(void *dst, void *src); // 移动构造到dst并析构src
+    void (*destroy)(void *);
+  };
+
+  template <typename D> struct Ops {
+    static R invoke(void *p, Args &&...args) {
+      if constexpr (std::is_void_v<R>) {
+        (*static_cast<D *>(p))(std::forward<Args>(args)...);
+      } else {
+        return (*static_cast<D *>(p))(std::forward<Args>(args)...);
+      }
+    }
+    static void move(void *dst, void *src) {
+      ::new (dst) D(std::move(*static_cast<D *>(src)));
+      static_cast<D *>(src)->~D();
+    }
+    static void destroy(void *p) { static_cast<D *>(p)->~D(); }
+    inline static constexpr const OpsTable kTable{invoke, move, destroy};
+  };
+
+  void moveFrom(InplaceFunction &rhs) {
+    if (rhs.m_ops != nullptr) {
+      rhs.m_ops->move(m_storage, rhs.m_storage);
+      m_ops = rhs.m_ops;
+      rhs.m_ops = nullptr;
+    }
+  }
+  void reset() {
+    if (m_ops != nullptr) {
+      m_ops->destroy(m_storage);
+      m_ops = nullptr;
+    }
+  }
+
+private:
+  alignas(std::max_align_t) unsigned char m_storage[Capacity];
+  const OpsTable *m_ops{nullptr};
+};
+} // namespace neonet
+#endif // INPLACEFUNCTION_H_
@@ -0,0 +1,54 @@
+/**
+ * @file LogFile.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 按大小和日期滚动的日志文件，只由日志后端线程使用，不加锁
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 文件名为basename.YYYYmmdd-HHMMSS.hostname.pid.log(UTC)，
+ * 写入超过rollSize字节或者跨过UTC零点时换一个新文件
+ *
+ */
+#ifndef LOGFILE_H_
+#define LOGFILE_H_
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+namespace neonet {
+class LogFile {
+public:
+  LogFile(const std::string &basename, size_t rollSize);
+  ~LogFile();
+  // noncopy
+  LogFile(const LogFile &) = delete;
+  LogFile &operator=(const LogFile &) = delete;
+
+  void append(const char *data, size_t len);
+  void flush();
+
+private:
+  /**
+   * @brief 关闭当前文件并以now命名打开新文件
+   *
+   * @param now
+   */
+  void rollFile(time_t now);
+  std::string getLogFileName(time_t now) const;
+
+  inline static constexpr const time_t kRollPerSeconds{60 * 60 * 24};
+  inline static constexpr const size_t kFileBufferSize{64 * 1024};
+
+  const std::string m_basename;
+  const size_t m_rollSize;
+  FILE *m_fp{nullptr};
+  std::unique_ptr<char[]> m_fileBuffer; // stdio的缓冲区
+  size_t m_written{0};                  // 当前文件已写入的字节数
+  time_t m_startOfPeriod{0};            // 当前文件所属的UTC日期的零点
+};
+} // namespace neonet
+#endif // LOGFILE_H_
@@ -0,0 +1,88 @@
+/**
+ * @file LogStream.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定长缓冲区上的日志流，格式化不分配内存、不加锁
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef LOGSTREAM_H_
+#define LOGSTREAM_H_
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+namespace neonet {
+class LogStream {
+public:
+  inline static constexpr const size_t kBufferSize{4096}; // 单条日志的最大长度
+
+  LogStream() = default;
+  // noncopy
+  LogStream(const LogStream &) = delete;
+  LogStream &operator=(const LogStream &) = delete;
+
+  LogStream &operator<<(bool v) { return *this << (v ? '1' : '0'); }
+  LogStream &operator<<(char v) {
+    append(&v, 1);
+    return *this;
+  }
+  LogStream &operator<<(short v) { return *this << static_cast<int>(v); }
+  LogStream &operator<<(unsigned short v) {
+    return *this << static_cast<unsigned int>(v);
+  }
+  LogStream &operator<<(int v);
+  LogStream &operator<<(unsigned int v);
+  LogStream &operator<<(long v);
+  LogStream &operator<<(unsigned long v);
+  LogStream &operator<<(long long v);
+  LogStream &operator<<(unsigned long long v);
+  LogStream &operator<<(double v);
+  LogStream &operator<<(float v) { return *this << static_cast<double>(v); }
+  LogStream &operator<<(const void *p);
+  LogStream &operator<<(std::thread::id id);
+  LogStream &operator<<(const char *str) {
+    if (str != nullptr) {
+      append(str, std::strlen(str));
+    } else {
+      append("(null)", 6);
+    }
+    return *this;
+  }
+  LogStream &operator<<(const std::string &str) {
+    append(str.data(), str.size());
+    return *this;
+  }
+  LogStream &operator<<(std::string_view str) {
+    append(str.data(), str.size());
+    return *this;
+  }
+
+  /**
+   * @brief 追加数据，放不下的部分被截断
+   *
+   * @param data
+   * @param len
+   */
+  void append(const char *data, size_t len) {
+    size_t n = std::min(len, avail());
+    std::memcpy(m_buffer + m_length, data, n);
+    m_length += n;
+  }
+  const char *data() const { return m_buffer; }
+  size_t length() const { return m_length; }
+  size_t avail() const { return kBufferSize - m_length; }
+  void reset() { m_length = 0; }
+
+private:
+  template <typename T> LogStream &formatInteger(T v);
+
+  char m_buffer[kBufferSize];
+  size_t m_length{0};
+};
+} // namespace neonet
+#endif // LOGSTREAM_H_
@@ -0,0 +1,111 @@
+/**
+ * @file Logging.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 日志前端：LOG_*宏按级别格式化一条日志，交给可替换的输出函数
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 级别分两层过滤：
+ * - 编译期：低于NEONET_LOG_MIN_LEVEL的宏展开为常量假的分支，优化后不产生代码。
+ *   定义了__DEBUG__时默认为TRACE，否则为INFO，即Release中TRACE/DEBUG不编译
+ * - 运行期：低于Logger::logLevel()的日志只做一次比较；默认INFO，
+ *   可以用环境变量NEONET_LOG_LEVEL=TRACE|DEBUG|INFO|WARN|ERROR|FATAL修改
+ * 默认输出到stdout；AsyncLogging::install之后写入后台线程的滚动文件
+ *
+ */
+#ifndef LOGGING_H_
+#define LOGGING_H_
+#include "base/LogStream.h"
+#include <cstddef>
+
+#ifndef NEONET_LOG_MIN_LEVEL
+#ifdef __DEBUG__
+#define NEONET_LOG_MIN_LEVEL 0 // TRACE
+#else
+#define NEONET_LOG_MIN_LEVEL 2 // INFO
+#endif
+#endif
+
+namespace neonet {
+class Logger {
+public:
+  enum LogLevel { TRACE, DEBUG, INFO, WARN, ERROR, FATAL, NUM_LOG_LEVELS };
+  using OutputFunc = void (*)(const char *msg, size_t len);
+  using FlushFunc = void (*)();
+
+  Logger(const char *file, int line, LogLevel level, const char *func);
+  /**
+   * @brief 附带errno描述的日志，toAbort为true时是FATAL
+   *
+   */
+  Logger(const char *file, int line, bool toAbort);
+  /**
+   * @brief 写出整条日志；FATAL时刷新输出并abort
+   *
+   */
+  ~Logger();
+
+  // noncopy
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  LogStream &stream() { return m_stream; }
+
+  static LogLevel logLevel();
+  static void setLogLevel(LogLevel level);
+  /**
+   * @brief 替换输出函数，nullptr还原为默认的stdout
+   *
+   */
+  static void setOutput(OutputFunc out);
+  static void setFlush(FlushFunc flush);
+  /**
+   * @brief 编译期是否保留该级别
+   *
+   */
+  static constexpr bool compiled(LogLevel level) {
+    return level >= NEONET_LOG_MIN_LEVEL;
+  }
+
+private:
+  void formatTime();
+
+  LogStream m_stream;
+  LogLevel m_level;
+  const char *m_file;
+  int m_line;
+};
+
+extern Logger::LogLevel g_logLevel;
+inline Logger::LogLevel Logger::logLevel() { return g_logLevel; }
+
+/**
+ * @brief errno对应的描述，线程安全
+ *
+ * @param savedErrno
+ * @return const char*
+ */
+const char *strerror_tl(int savedErrno);
+} // namespace neonet
+
+#define NEONET_LOG_IF(level)                                                   \
+  if (!(neonet::Logger::compiled(neonet::Logger::level) &&                     \
+        neonet::Logger::logLevel() <= neonet::Logger::level)) {                \
+  } else                                                                       \
+    neonet::Logger(__FILE__, __LINE__, neonet::Logger::level, __func__)        \
+        .stream()
+
+#define LOG_TRACE NEONET_LOG_IF(TRACE)
+#define LOG_DEBUG NEONET_LOG_IF(DEBUG)
+#define LOG_INFO NEONET_LOG_IF(INFO)
+#define LOG_WARN NEONET_LOG_IF(WARN)
+#define LOG_ERROR NEONET_LOG_IF(ERROR)
+#define LOG_FATAL                                                              \
+  neonet::Logger(__FILE__, __LINE__, neonet::Logger::FATAL, __func__).stream()
+#define LOG_SYSERR neonet::Logger(__FILE__, __LINE__, false).stream()
+#define LOG_SYSFATAL neonet::Logger(__FILE__, __LINE__, true).stream()
+
+#endif // LOGGING_H_
@@ -0,0 +1,80 @@
+/**
+ * @file MpscQueue.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 侵入式无锁多生产者单消费者队列(Vyukov MPSC)
+ * @version 0.1
+ * @date 2024-07-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * Node必须有一个std::atomic<Node *> next成员并且可以默认构造(用作stub)。
+ * push是一次exchange加一次store，任意线程可以并发调用；pop只能由一个线程调用。
+ * 生产者在exchange和store之间被打断时，队列会短暂处于"不一致"状态，
+ * 此时pop返回nullptr，但队列并不为空
+ *
+ */
+#ifndef MPSCQUEUE_H_
+#define MPSCQUEUE_H_
+#include <atomic>
+namespace neonet {
+template <typename Node> class MpscQueue {
+public:
+  MpscQueue() : m_head(&m_stub), m_tail(&m_stub) {}
+
+  // noncopy
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /**
+   * @brief 入队，线程安全，wait-free
+   *
+   * @param node
+   */
+  void push(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /**
+   * @brief 出队，只能由消费者线程调用
+   *
+   * @return Node* 队列为空或处于不一致状态时返回nullptr
+   */
+  Node *pop() {
+    Node *tail = m_tail;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &m_stub) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      m_tail = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      m_tail = next;
+      return tail;
+    }
+    Node *head = m_head.load(std::memory_order_acquire);
+    if (tail != head) {
+      return nullptr;
+    }
+    // 只剩最后一个节点，先把stub挂在它后面，才能把它取走
+    push(&m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      m_tail = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+private:
+  std::atomic<Node *> m_head; // 生产者端，最后入队的节点
+  Node *m_tail;               // 消费者端，下一个出队的节点
+  Node m_stub;
+};
+} // namespace neonet
+#endif // MPSCQUEUE_H_
@@ -0,0 +1,95 @@
+/**
+ * @file NodePool.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定长无锁节点池，任意线程取出和归还节点
+ * @version 0.1
+ * @date 2024-07-31
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 节点存放在对象内的数组中，空闲节点用下标串成栈；栈顶是(版本号<<32 | 下标+1)，
+ * 每次修改版本号加一，用64位CAS避免ABA。池空时acquire返回nullptr，
+ * 由调用方退回到堆分配
+ *
+ */
+#ifndef NODEPOOL_H_
+#define NODEPOOL_H_
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+namespace neonet {
+template <typename Node, size_t N> class NodePool {
+  static_assert(N > 0 && N < UINT32_MAX, "bad NodePool size");
+
+public:
+  NodePool() {
+    for (size_t i = 0; i < N; ++i) {
+      m_next[i].store(static_cast<uint32_t>(i + 1 < N ? i + 2 : 0),
+                      std::memory_order_relaxed);
+    }
+    m_head.store(1, std::memory_order_relaxed);
+  }
+
+  // noncopy
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  /**
+   * @brief 取出一个空闲节点，线程安全
+   *
+   * @return Node* 池空时返回nullptr
+   */
+  Node *acquire() {
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t index = static_cast<uint32_t>(head);
+      if (index == 0) {
+        return nullptr;
+      }
+      uint64_t next = nextVersion(head) |
+                      m_next[index - 1].load(std::memory_order_relaxed);
+      if (m_head.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                       std::memory_order_acquire)) {
+        return &m_nodes[index - 1];
+      }
+    }
+  }
+
+  /**
+   * @brief 归还acquire得到的节点，线程安全
+   *
+   * @param node
+   */
+  void release(Node *node) {
+    assert(owns(node));
+    uint32_t index = static_cast<uint32_t>(node - m_nodes) + 1;
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    for (;;) {
+      m_next[index - 1].store(static_cast<uint32_t>(head),
+                              std::memory_order_relaxed);
+      if (m_head.compare_exchange_weak(head, nextVersion(head) | index,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  bool owns(const Node *node) const {
+    return node >= m_nodes && node < m_nodes + N;
+  }
+
+private:
+  static uint64_t nextVersion(uint64_t head) {
+    return ((head >> 32) + 1) << 32;
+  }
+
+private:
+  std::atomic<uint64_t> m_head; // 空闲栈顶: 版本号<<32 | 下标+1，0表示空
+  std::atomic<uint32_t> m_next[N]; // 空闲栈中下一个节点的下标+1
+  Node m_nodes[N];
+};
+} // namespace neonet
+#endif // NODEPOOL_H_
@@ -0,0 +1,170 @@
+/**
+ * @file SlabPool.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定长内存块的slab池，以及可用于std::allocate_shared的分配器
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 内存块按缓存行对齐，成批从堆上申请(chunk)，之后只在池内循环使用，
+ * 直到池析构或者trim时才归还。只有所属线程(创建池的线程)分配；任意线程都可以释放：
+ * 所属线程释放到本地空闲链表，其他线程用CAS压入远程空闲栈，
+ * 所属线程在本地链表用完时一次取走整个远程栈，因此没有ABA问题。
+ * 池由shared_ptr管理，分配器持有池的引用，池在最后一个块归还后才析构
+ *
+ */
+#ifndef SLABPOOL_H_
+#define SLABPOOL_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+namespace neonet {
+class SlabPool {
+public:
+  inline static constexpr const size_t kAlignment{64}; // 块的对齐(缓存行)
+  inline static constexpr const size_t kDefaultBlocksPerChunk{64};
+
+  /**
+   * @brief 在所属线程中创建
+   *
+   * @param blockSize 块大小，向上取整到kAlignment的倍数
+   * @param blocksPerChunk 每次向堆申请的块数
+   */
+  explicit SlabPool(size_t blockSize,
+                    size_t blocksPerChunk = kDefaultBlocksPerChunk);
+  ~SlabPool();
+
+  // noncopy
+  SlabPool(const SlabPool &) = delete;
+  SlabPool &operator=(const SlabPool &) = delete;
+
+  /**
+   * @brief 取出一个块，只能在所属线程调用
+   *
+   * @return void*
+   */
+  void *allocate();
+  /**
+   * @brief 同上，但没有空闲块时返回nullptr而不是申请新的chunk
+   *
+   * @return void*
+   */
+  void *tryAllocate();
+  /**
+   * @brief 归还allocate得到的块，线程安全
+   *
+   * @param block
+   */
+  void deallocate(void *block);
+  /**
+   * @brief 把所有块都空闲的chunk还给堆，只能在所属线程调用
+   *
+   * @details 先取走远程空闲栈，再按地址统计每个chunk的空闲块数，
+   * 耗时与空闲块数成正比
+   * @return size_t 归还的chunk数
+   */
+  size_t trim();
+
+  size_t blockSize() const { return m_blockSize; }
+  size_t blocksPerChunk() const { return m_blocksPerChunk; }
+  /**
+   * @brief 正在使用的块数；线程安全
+   *
+   */
+  size_t inUse() const { return m_inUse.load(std::memory_order_relaxed); }
+  /**
+   * @brief 已经从堆上申请的块数；线程安全
+   *
+   */
+  size_t capacity() const {
+    return m_capacity.load(std::memory_order_relaxed);
+  }
+  /**
+   * @brief 由其他线程归还的块数，即经过远程空闲栈的释放次数；线程安全
+   *
+   */
+  uint64_t remoteFrees() const {
+    return m_remoteFrees.load(std::memory_order_relaxed);
+  }
+  bool isOwnerThread() const {
+    return m_ownerThread == std::this_thread::get_id();
+  }
+
+private:
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  /**
+   * @brief 申请一个chunk，切分后放入本地空闲链表
+   *
+   */
+  void grow();
+
+  const size_t m_blockSize;
+  const size_t m_blocksPerChunk;
+  const std::thread::id m_ownerThread{std::this_thread::get_id()};
+  FreeBlock *m_localFree{nullptr};           // 只在所属线程访问
+  std::vector<void *> m_chunks;              // 只在所属线程访问
+  std::atomic<FreeBlock *> m_remoteFree{nullptr}; // 其他线程归还的块
+  std::atomic<size_t> m_inUse{0};
+  std::atomic<size_t> m_capacity{0};
+  std::atomic<uint64_t> m_remoteFrees{0};
+};
+
+/**
+ * @brief 从SlabPool分配的分配器，满足Allocator要求，可以rebind；
+ * 放不进一个块的请求退回到std::allocator
+ *
+ * @tparam T
+ */
+template <typename T> class SlabAllocator {
+public:
+  using value_type = T;
+
+  explicit SlabAllocator(std::shared_ptr<SlabPool> pool) noexcept
+      : m_pool(std::move(pool)) {}
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U> &other) noexcept
+      : m_pool(other.pool()) {}
+
+  T *allocate(size_t n) {
+    if (fits(n)) {
+      return static_cast<T *>(m_pool->allocate());
+    }
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) noexcept {
+    if (fits(n)) {
+      m_pool->deallocate(p);
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  const std::shared_ptr<SlabPool> &pool() const { return m_pool; }
+
+private:
+  bool fits(size_t n) const {
+    return m_pool && alignof(T) <= SlabPool::kAlignment &&
+           n * sizeof(T) <= m_pool->blockSize();
+  }
+
+  std::shared_ptr<SlabPool> m_pool;
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T> &a, const SlabAllocator<U> &b) {
+  return a.pool() == b.pool();
+}
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T> &a, const SlabAllocator<U> &b) {
+  return !(a == b);
+}
+} // namespace neonet
+#endif // SLABPOOL_H_
@@ -0,0 +1,72 @@
+/**
+ * @file Timestamp.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 微秒精度的时间戳，基于CLOCK_MONOTONIC，不受系统时间调整影响
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+#include <cstdint>
+#include <time.h>
+namespace neonet {
+class Timestamp {
+public:
+  inline static constexpr const int64_t kMicroSecondsPerSecond{1000 * 1000};
+
+  Timestamp() = default;
+  explicit Timestamp(int64_t microSeconds) : m_microSeconds(microSeconds) {}
+
+  /**
+   * @brief 当前的单调时钟时间
+   *
+   * @return Timestamp
+   */
+  static Timestamp now() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond +
+                     ts.tv_nsec / 1000);
+  }
+  static Timestamp invalid() { return Timestamp(); }
+
+  bool valid() const { return m_microSeconds > 0; }
+  int64_t microSeconds() const { return m_microSeconds; }
+
+  /**
+   * @brief 在当前时间上增加seconds秒
+   *
+   * @param seconds
+   * @return Timestamp
+   */
+  Timestamp addTime(double seconds) const {
+    return Timestamp(m_microSeconds +
+                     static_cast<int64_t>(seconds * kMicroSecondsPerSecond));
+  }
+  /**
+   * @brief 两个时间戳相差的秒数
+   *
+   * @param high
+   * @param low
+   * @return double
+   */
+  static double timeDifference(Timestamp high, Timestamp low) {
+    int64_t diff = high.m_microSeconds - low.m_microSeconds;
+    return static_cast<double>(diff) / kMicroSecondsPerSecond;
+  }
+
+  bool operator<(Timestamp rhs) const {
+    return m_microSeconds < rhs.m_microSeconds;
+  }
+  bool operator==(Timestamp rhs) const {
+    return m_microSeconds == rhs.m_microSeconds;
+  }
+
+private:
+  int64_t m_microSeconds{0};
+};
+} // namespace neonet
+#endif // TIMESTAMP_H_
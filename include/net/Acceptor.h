@@ -33,6 +33,29 @@ public:
 
   bool listenning() const { return m_listenning; }
   void listen();
+  /**
+   * @brief 监听套接字使用边沿触发，每次事件accept到EAGAIN；在listen之前调用
+   *
+   */
+  void setEdgeTriggered();
+
+private:
+  /**
+   * @brief 监听套接字可读时的回调
+   *
+   */
+  void handleRead();
+  /**
+   * @brief 完成模式下处理poller已经接受的连接
+   *
+   */
+  void handleAcceptCompletions();
+  /**
+   * @brief accept一个连接
+   *
+   * @return bool 是否还可能有等待accept的连接
+   */
+  bool acceptOne();
 
 private:
   EventLoop *m_loop;                             // 所属EventLoop
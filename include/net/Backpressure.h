@@ -0,0 +1,90 @@
+/**
+ * @file Backpressure.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 转发场景的背压策略：下游输出积压时暂停上游的读取
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * attach在下游连接上安装高低水位回调。下游的输出缓冲链达到高水位时，
+ * 由SourceResolver找到当前的上游并throttleRead；降到低水位时unthrottleRead。
+ * 上游可以属于其他loop。下游连接析构时仍被它暂停的上游会被恢复，
+ * 所以下游断开不会让上游一直停读。
+ * 暂停是计数的，多个下游可以同时暂停同一个上游
+ *
+ */
+#ifndef BACKPRESSURE_H_
+#define BACKPRESSURE_H_
+#include "base/Callbacks.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+namespace neonet {
+class Backpressure {
+public:
+  /**
+   * @brief 返回dst当前的上游，没有时返回空；在dst所属loop中调用
+   *
+   */
+  using SourceResolver =
+      std::function<TcpConnectionPtr(const TcpConnectionPtr &dst)>;
+
+  /**
+   * @brief
+   *
+   * @param highWaterMark 下游输出缓冲链达到该字节数时暂停上游
+   * @param lowWaterMark 降到该字节数时恢复上游，应小于highWaterMark
+   * @param resolver
+   */
+  Backpressure(size_t highWaterMark, size_t lowWaterMark,
+               SourceResolver resolver);
+
+  // noncopy
+  Backpressure(const Backpressure &) = delete;
+  Backpressure &operator=(const Backpressure &) = delete;
+
+  /**
+   * @brief 在dst的连接回调中调用，替换dst已有的高低水位回调；
+   * Backpressure必须比dst活得久
+   *
+   * @param dst
+   */
+  void attach(const TcpConnectionPtr &dst);
+
+  /**
+   * @brief 暂停和恢复上游的累计次数；线程安全
+   *
+   */
+  uint64_t pauses() const { return m_pauses.load(std::memory_order_relaxed); }
+  uint64_t resumes() const {
+    return m_resumes.load(std::memory_order_relaxed);
+  }
+
+private:
+  /**
+   * @brief 一个下游的状态，由它的两个水位回调共同持有，只在下游所属loop中访问
+   *
+   */
+  struct Link {
+    Backpressure *owner;
+    std::weak_ptr<TCPConnection> pausedSource; // 被本下游暂停的上游
+
+    explicit Link(Backpressure *backpressure) : owner(backpressure) {}
+    ~Link() { owner->resume(this); }
+  };
+
+  void pause(Link *link, const TcpConnectionPtr &dst);
+  void resume(Link *link);
+
+  const size_t m_highWaterMark;
+  const size_t m_lowWaterMark;
+  SourceResolver m_resolver;
+  std::atomic<uint64_t> m_pauses{0};
+  std::atomic<uint64_t> m_resumes{0};
+};
+} // namespace neonet
+#endif // BACKPRESSURE_H_
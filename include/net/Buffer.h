@@ -1,16 +1,400 @@
 /**
  * @file Buffer.h
  * @author lzy (lzy_cs_LN@163.com)
- * @brief
+ * @brief 连续可增长的字节缓冲区，头部预留prepend空间
  * @version 0.1
  * @date 2024-07-24
  *
  * @copyright Copyright (c) 2024
  *
+ * @details 缓冲区布局如下：
+ *
+ * +-------------------+------------------+------------------+
+ * | prependable bytes |  readable bytes  |  writable bytes  |
+ * |                   |     (CONTENT)    |                  |
+ * +-------------------+------------------+------------------+
+ * |                   |                  |                  |
+ * 0      <=      readerIndex   <=   writerIndex    <=     size
+ *
+ * 挂在BufferPool上的Buffer没有数据时不持有存储(三个下标都为0)，
+ * 写入时从池中借用块，取空后立即归还。
+ *
+ * makeMirrored之后存储改为环形：同一个memfd的capacity字节被连续映射两次，
+ * 读下标总在[0, capacity)内，越过capacity时两个下标同时减去capacity，
+ * 可读区和可写区总是连续的，不再需要把数据挪到前面；
+ * 头部空间就是环中的空闲空间，prepend越过起点时回绕到后一份映射
+ *
  */
 #ifndef BUFFER_H_
 #define BUFFER_H_
+#include "net/BufferPool.h"
+#include "tools/Bytetransform.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/types.h>
 namespace neonet {
-class Buffer {};
+class Buffer {
+public:
+  inline static constexpr const size_t kCheapPrepend{8}; // 预留的头部空间
+  inline static constexpr const size_t kInitialSize{1024}; // 初始可写空间
+  // 环形存储的默认容量
+  inline static constexpr const size_t kMirroredSize{256 * 1024};
+
+  explicit Buffer(size_t initialSize = kInitialSize)
+      : m_storage{new char[kCheapPrepend + initialSize],
+                  kCheapPrepend + initialSize, false},
+        m_readerIndex(kCheapPrepend), m_writerIndex(kCheapPrepend) {}
+  /**
+   * @brief 挂在pool上的空Buffer，有数据时才借用存储
+   *
+   * @param pool
+   */
+  explicit Buffer(std::shared_ptr<BufferPool> pool)
+      : m_storage{nullptr, 0, false}, m_pool(std::move(pool)),
+        m_readerIndex(0), m_writerIndex(0) {}
+  ~Buffer() { releaseStorage(); }
+
+  /**
+   * @brief 拷贝可读数据，新的存储与other挂在同一个池上，或者同样是环形的
+   *
+   * @param other
+   */
+  Buffer(const Buffer &other);
+  Buffer &operator=(const Buffer &other);
+  /**
+   * @brief 取走other的存储，other变为空，但仍挂在原来的池上；
+   * 不在池上的other同样不持有存储，下次写入时再从堆上分配
+   *
+   * @param other
+   */
+  Buffer(Buffer &&other) noexcept;
+  Buffer &operator=(Buffer &&other) noexcept;
+
+  void swap(Buffer &rhs) {
+    std::swap(m_storage, rhs.m_storage);
+    m_pool.swap(rhs.m_pool);
+    std::swap(m_readerIndex, rhs.m_readerIndex);
+    std::swap(m_writerIndex, rhs.m_writerIndex);
+  }
+
+  size_t readableBytes() const { return m_writerIndex - m_readerIndex; }
+  size_t writableBytes() const {
+    return m_storage.mirrored ? m_storage.size - readableBytes()
+                              : m_storage.size - m_writerIndex;
+  }
+  size_t prependableBytes() const {
+    return m_storage.mirrored ? m_storage.size - readableBytes()
+                              : m_readerIndex;
+  }
+
+  /**
+   * @brief 可读数据的起始地址
+   *
+   * @return const char*
+   */
+  const char *peek() const { return begin() + m_readerIndex; }
+
+  /**
+   * @brief 取走len字节的可读数据，只移动读下标，不拷贝
+   *
+   * @param len
+   */
+  void retrieve(size_t len) {
+    assert(len <= readableBytes());
+    if (len < readableBytes()) {
+      m_readerIndex += len;
+      if (m_storage.mirrored && m_readerIndex >= m_storage.size) {
+        m_readerIndex -= m_storage.size;
+        m_writerIndex -= m_storage.size;
+      }
+    } else {
+      retrieveAll();
+    }
+  }
+  void retrieveUntil(const char *end) {
+    assert(peek() <= end);
+    assert(end <= beginWrite());
+    retrieve(end - peek());
+  }
+  void retrieveInt64() { retrieve(sizeof(int64_t)); }
+  void retrieveInt32() { retrieve(sizeof(int32_t)); }
+  void retrieveInt16() { retrieve(sizeof(int16_t)); }
+  void retrieveInt8() { retrieve(sizeof(int8_t)); }
+  void retrieveAll() {
+    if (m_pool || m_storage.data == nullptr) {
+      // 没有存储时三个下标保持为0，下次写入时再分配
+      releaseStorage();
+      return;
+    }
+    m_readerIndex = m_storage.mirrored ? 0 : kCheapPrepend;
+    m_writerIndex = m_readerIndex;
+  }
+  std::string retrieveAllAsString() {
+    return retrieveAsString(readableBytes());
+  }
+  std::string retrieveAsString(size_t len) {
+    assert(len <= readableBytes());
+    std::string result(peek(), len);
+    retrieve(len);
+    return result;
+  }
+
+  /**
+   * @brief 追加数据到可写区域，空间不足时扩容或整理
+   *
+   * @param data
+   * @param len
+   */
+  void append(const char *data, size_t len) {
+    ensureWritableBytes(len);
+    std::copy(data, data + len, beginWrite());
+    hasWritten(len);
+  }
+  void append(const void *data, size_t len) {
+    append(static_cast<const char *>(data), len);
+  }
+  void append(const std::string &str) { append(str.data(), str.size()); }
+
+  void ensureWritableBytes(size_t len) {
+    if (writableBytes() < len) {
+      makeSpace(len);
+    }
+    assert(writableBytes() >= len);
+  }
+
+  char *beginWrite() { return begin() + m_writerIndex; }
+  const char *beginWrite() const { return begin() + m_writerIndex; }
+  void hasWritten(size_t len) {
+    assert(len <= writableBytes());
+    m_writerIndex += len;
+  }
+  void unwrite(size_t len) {
+    assert(len <= readableBytes());
+    m_writerIndex -= len;
+  }
+
+  /**
+   * @brief 以网络字节序追加整数
+   *
+   * @param x
+   */
+  void appendInt64(int64_t x) {
+    int64_t be64 = socket::hostToNetwork64(x);
+    append(&be64, sizeof be64);
+  }
+  void appendInt32(int32_t x) {
+    int32_t be32 = socket::hostToNetwork32(x);
+    append(&be32, sizeof be32);
+  }
+  void appendInt16(int16_t x) {
+    int16_t be16 = socket::hostToNetwork16(x);
+    append(&be16, sizeof be16);
+  }
+  void appendInt8(int8_t x) { append(&x, sizeof x); }
+
+  /**
+   * @brief 读取并取走网络字节序的整数，要求readableBytes() >= sizeof(int)
+   *
+   * @return int32_t
+   */
+  int64_t readInt64() {
+    int64_t result = peekInt64();
+    retrieveInt64();
+    return result;
+  }
+  int32_t readInt32() {
+    int32_t result = peekInt32();
+    retrieveInt32();
+    return result;
+  }
+  int16_t readInt16() {
+    int16_t result = peekInt16();
+    retrieveInt16();
+    return result;
+  }
+  int8_t readInt8() {
+    int8_t result = peekInt8();
+    retrieveInt8();
+    return result;
+  }
+
+  /**
+   * @brief 只读取不取走网络字节序的整数，要求readableBytes() >= sizeof(int)
+   *
+   * @return int32_t
+   */
+  int64_t peekInt64() const {
+    assert(readableBytes() >= sizeof(int64_t));
+    int64_t be64 = 0;
+    ::memcpy(&be64, peek(), sizeof be64);
+    return socket::networkToHost64(be64);
+  }
+  int32_t peekInt32() const {
+    assert(readableBytes() >= sizeof(int32_t));
+    int32_t be32 = 0;
+    ::memcpy(&be32, peek(), sizeof be32);
+    return socket::networkToHost32(be32);
+  }
+  int16_t peekInt16() const {
+    assert(readableBytes() >= sizeof(int16_t));
+    int16_t be16 = 0;
+    ::memcpy(&be16, peek(), sizeof be16);
+    return socket::networkToHost16(be16);
+  }
+  int8_t peekInt8() const {
+    assert(readableBytes() >= sizeof(int8_t));
+    int8_t x = *peek();
+    return x;
+  }
+
+  /**
+   * @brief 在可读数据前写入数据(如Header)，不需要移动已有数据
+   *
+   * @param data
+   * @param len
+   */
+  void prepend(const void *data, size_t len) {
+    assert(len <= prependableBytes());
+    if (m_storage.mirrored && m_readerIndex < len) {
+      m_readerIndex += m_storage.size;
+      m_writerIndex += m_storage.size;
+    }
+    m_readerIndex -= len;
+    const char *d = static_cast<const char *>(data);
+    std::copy(d, d + len, begin() + m_readerIndex);
+  }
+  void prependInt64(int64_t x) {
+    int64_t be64 = socket::hostToNetwork64(x);
+    prepend(&be64, sizeof be64);
+  }
+  void prependInt32(int32_t x) {
+    int32_t be32 = socket::hostToNetwork32(x);
+    prepend(&be32, sizeof be32);
+  }
+  void prependInt16(int16_t x) {
+    int16_t be16 = socket::hostToNetwork16(x);
+    prepend(&be16, sizeof be16);
+  }
+  void prependInt8(int8_t x) { prepend(&x, sizeof x); }
+
+  /**
+   * @brief 收缩缓冲区，只保留可读数据和reserve字节的可写空间
+   *
+   * @param reserve
+   */
+  void shrink(size_t reserve);
+
+  size_t internalCapacity() const { return m_storage.size; }
+  /**
+   * @brief 是否挂在BufferPool上
+   *
+   */
+  bool pooled() const { return static_cast<bool>(m_pool); }
+  /**
+   * @brief 改用capacity字节(向上取整到页)的环形存储，保留可读数据；
+   * 挂在池上的Buffer归还块并脱离池。环形存储只在扩容和收缩时拷贝数据
+   *
+   * @param capacity
+   * @return true 成功或者已经是环形的
+   * @return false memfd_create或mmap失败，存储不变
+   */
+  bool makeMirrored(size_t capacity = kMirroredSize);
+  bool mirrored() const { return m_storage.mirrored; }
+
+  /**
+   * @brief 从fd中读取数据，使用readv配合栈上额外缓冲区，一次系统调用尽量读完；
+   * 环形存储只读进连续的可写区，可写区为空时先扩容。
+   * 池化的Buffer在BufferPool超过全局上限时只读进已有的存储或池中空闲的块
+   *
+   * @param fd
+   * @param savedErrno 出错时保存的errno；超过上限且没有可写空间时为ENOBUFS
+   * @return ssize_t read的返回值
+   */
+  ssize_t readFd(int fd, int *savedErrno);
+
+private:
+  char *begin() { return m_storage.data; }
+  const char *begin() const { return m_storage.data; }
+
+  /**
+   * @brief 腾出len字节的可写空间；如果总空闲空间足够，就把可读数据挪到前面
+   *
+   * @param len
+   */
+  void makeSpace(size_t len) {
+    if (m_storage.mirrored ||
+        writableBytes() + prependableBytes() < len + kCheapPrepend) {
+      grow(len);
+    } else {
+      assert(kCheapPrepend < m_readerIndex);
+      size_t readable = readableBytes();
+      std::copy(begin() + m_readerIndex, begin() + m_writerIndex,
+                begin() + kCheapPrepend);
+      m_readerIndex = kCheapPrepend;
+      m_writerIndex = m_readerIndex + readable;
+      assert(readable == readableBytes());
+    }
+  }
+
+  /**
+   * @brief 换一块能容纳可读数据和len字节可写空间的存储，可读数据挪到前面
+   *
+   * @param len
+   */
+  void grow(size_t len);
+  /**
+   * @brief 换成size字节的新存储，可读数据拷贝到kCheapPrepend处
+   *
+   * @param size
+   */
+  void reallocate(size_t size);
+  /**
+   * @brief 换成从池中借来的block，可读数据拷贝到kCheapPrepend处
+   *
+   * @param block
+   */
+  void adoptBlock(const BufferPool::Block &block);
+  /**
+   * @brief 不超出全局上限地把池化的存储扩大到至少size字节
+   *
+   * @param size
+   * @return false 池中没有合适的块且无法申请新内存，存储不变
+   */
+  bool tryReallocate(size_t size);
+  /**
+   * @brief 换成至少size字节的环形存储，可读数据拷贝到起点
+   *
+   * @param size
+   * @return true
+   * @return false 映射失败，存储不变
+   */
+  bool remapMirrored(size_t size);
+  /**
+   * @brief 归还存储，三个下标归零；不挂在池上的存储直接释放
+   *
+   */
+  void releaseStorage();
+
+  /**
+   * @brief 存储及其类型，与两个下标一起不超过48字节，
+   * 使Buffer可以放进跨线程发送的任务中
+   *
+   */
+  struct Storage {
+    char *data;
+    size_t size : 63;     // 容量，环形存储时是一份映射的大小
+    size_t mirrored : 1;  // 是否是双重映射的环形存储
+  };
+
+private:
+  Storage m_storage;                  // 实际存储，可能来自m_pool
+  std::shared_ptr<BufferPool> m_pool; // 借用存储的池，为空时使用堆
+  size_t m_readerIndex;               // 读下标
+  size_t m_writerIndex;               // 写下标
+};
 } // namespace neonet
-#endif // BUFFER_H_
\ No newline at end of file
+#endif // BUFFER_H_
@@ -0,0 +1,149 @@
+/**
+ * @file BufferChain.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 由多个Buffer段组成的输出缓冲链，用writev一次性发送
+ * @version 0.1
+ * @date 2024-07-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 追加数据只会写入尾段的空闲空间或新建一个段，已有数据从不被拷贝或移动；
+ * 部分写出后只移动首段的读下标，不需要像单个Buffer那样memmove整理。
+ * 段也可以是管道中的若干字节(appendPipe)，发送时直接splice到socket；
+ * 或者文件的一段区域(appendFile)，发送时用sendfile从页缓存直接写到socket，
+ * 每次最多kFileChunkSize字节。两者的数据都不经过用户空间。
+ * 挂在BufferPool上时新段从池中借用存储，段取空后立即归还
+ *
+ */
+#ifndef BUFFERCHAIN_H_
+#define BUFFERCHAIN_H_
+#include "net/Buffer.h"
+#include <deque>
+#include <memory>
+#include <sys/types.h>
+namespace neonet {
+class SplicePipe;
+
+class BufferChain {
+public:
+  inline static constexpr const size_t kSegmentSize{4096}; // 新建段的最小容量
+  // 文件段每次sendfile的最大字节数，避免一个连接长时间占用loop
+  inline static constexpr const size_t kFileChunkSize{256 * 1024};
+
+  /**
+   * @brief writeFd写出文件段的一块之后，该文件区域的发送进度
+   *
+   */
+  struct FileProgress {
+    size_t sent{0};  // 区域中已经发送的字节数
+    size_t total{0}; // 区域的总字节数，0表示这次写出的不是文件段
+  };
+
+  explicit BufferChain(std::shared_ptr<BufferPool> pool = nullptr)
+      : m_pool(std::move(pool)) {}
+  ~BufferChain();
+  // noncopy
+  BufferChain(const BufferChain &) = delete;
+  BufferChain &operator=(const BufferChain &) = delete;
+
+  /**
+   * @brief 链中所有段的可读字节数之和
+   *
+   * @return size_t
+   */
+  size_t readableBytes() const { return m_readableBytes; }
+  bool empty() const { return m_readableBytes == 0; }
+  size_t segmentCount() const { return m_segments.size(); }
+
+  /**
+   * @brief 拷贝数据到尾段的空闲空间，不够时追加新段
+   *
+   * @param data
+   * @param len
+   */
+  void append(const void *data, size_t len);
+  /**
+   * @brief 将整个Buffer作为一个新段挂到链尾，不拷贝数据
+   *
+   * @param buf
+   */
+  void append(Buffer &&buf);
+  /**
+   * @brief 追加管道中已有的len字节，与尾段是同一个管道时合并
+   *
+   * @param pipe
+   * @param len
+   */
+  void appendPipe(const std::shared_ptr<SplicePipe> &pipe, size_t len);
+  /**
+   * @brief 追加文件fd从offset开始的len字节，链接管fd，段取完或链析构时关闭
+   *
+   * @param fd
+   * @param offset
+   * @param len
+   * @param regionLength 整个文件区域的字节数，前面已经直接发送了一部分时
+   * 大于len，用于计算进度；0表示等于len
+   */
+  void appendFile(int fd, off_t offset, size_t len, size_t regionLength = 0);
+
+  /**
+   * @brief 丢弃链首的len字节，管道段的字节从管道中读出丢弃
+   *
+   * @param len
+   */
+  void retrieve(size_t len);
+  void retrieveAll();
+
+  /**
+   * @brief 用一次writev写出首部最多IOV_MAX个内存段；首段是管道段时
+   * 改为一次splice，是文件段时改为一次sendfile
+   *
+   * @param fd
+   * @param savedErrno 出错时保存的errno，文件比段短时为EIO
+   * @param progress 不为空时填写这次写出的文件段的进度，不是文件段时total为0
+   * @return ssize_t writev/splice/sendfile的返回值，
+   * 写出的字节已经从链中取走
+   */
+  ssize_t writeFd(int fd, int *savedErrno, FileProgress *progress = nullptr);
+
+private:
+  /**
+   * @brief 内存段、管道段或文件段，后两者的buffer为空
+   *
+   */
+  struct Segment {
+    Buffer buffer;
+    std::shared_ptr<SplicePipe> pipe;
+    size_t pipeBytes{0}; // 管道段在管道中的字节数
+    int file{-1};        // 文件段的fd，由链关闭
+    off_t fileOffset{0}; // 文件段下一个要发送的字节在文件中的位置
+    size_t fileBytes{0}; // 文件段还要发送的字节数
+    size_t fileLength{0}; // 文件段所属区域的总字节数
+
+    // 管道段或文件段，不持有内存
+    Segment() : buffer(std::shared_ptr<BufferPool>()) {}
+    explicit Segment(Buffer &&buf) : buffer(std::move(buf)) {}
+    bool inMemory() const { return !pipe && file < 0; }
+    size_t readableBytes() const {
+      return pipe ? pipeBytes : file >= 0 ? fileBytes : buffer.readableBytes();
+    }
+  };
+
+  /**
+   * @brief 移除首段，文件段同时关闭fd
+   *
+   */
+  void popFront();
+  /**
+   * @brief 用一次sendfile写出文件首段的最多kFileChunkSize字节
+   *
+   */
+  ssize_t sendFileSegment(int fd, int *savedErrno, FileProgress *progress);
+
+  std::deque<Segment> m_segments; // 段链表，只在两端增删，不移动已有的段
+  size_t m_readableBytes{0};      // 所有段的可读字节数之和
+  std::shared_ptr<BufferPool> m_pool; // 新段借用存储的池，为空时使用堆
+};
+} // namespace neonet
+#endif // BUFFERCHAIN_H_
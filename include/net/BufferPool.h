@@ -0,0 +1,179 @@
+/**
+ * @file BufferPool.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 按大小分级的缓冲区内存块池，每个EventLoop一个
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 块分为2KB/16KB/64KB三级，每级是一个SlabPool，每次向堆申请kChunkBytes。
+ * 挂在池上的Buffer只在有数据时借用块，取空后立即归还，空闲连接不占用缓冲内存。
+ * 超过最大级别或者不在所属线程时退回到普通堆分配，这些块用完直接释放。
+ * 堆上的块大小从不等于某个级别的大小，归还时按大小区分两者。
+ *
+ * 全局上限约束所有池的chunk和堆上的块的总字节数。tryAcquire在需要新内存
+ * 且会超出上限时失败，Buffer::readFd据此不再扩容，连接暂停读取直到有块归还；
+ * acquire用于必须保存的数据(发送的数据、完成模式下内核已经收下的数据)，
+ * 超出上限时照样从堆上分配并计入总数。每级的空闲chunk超过kIdleChunks个时，
+ * 所属线程归还块时把完全空闲的chunk还给堆；达到上限时先回收本池的空闲chunk。
+ * 检查和增加不是原子的，每个loop最多超出一个chunk或者一次读取的大小
+ *
+ */
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+#include "base/SlabPool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+namespace neonet {
+class BufferPool {
+public:
+  inline static constexpr const size_t kClassCount{3};
+  inline static constexpr const size_t kClassSizes[kClassCount]{
+      2 * 1024, 16 * 1024, 64 * 1024};
+  inline static constexpr const size_t kChunkBytes{64 * 1024};
+  // 每级保留的空闲chunk数，超过后归还块时回收完全空闲的chunk
+  inline static constexpr const size_t kIdleChunks{2};
+
+  /**
+   * @brief 借出的一块内存
+   *
+   */
+  struct Block {
+    char *data{nullptr};
+    size_t size{0};
+  };
+
+  /**
+   * @brief 块是否来自池中，否则是堆分配
+   *
+   */
+  static bool isPooled(const Block &block) {
+    for (size_t size : kClassSizes) {
+      if (block.size == size) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  struct Stats {
+    size_t pooledBytes{0};     // 池从堆上申请的字节数
+    size_t inUseBytes{0};      // 池中借出的字节数
+    size_t heapBytes{0};       // 借出的堆上的块的字节数
+    size_t trimmedBytes{0};    // 回收空闲chunk归还给堆的字节数
+    uint64_t heapBlocks{0};    // 退回堆分配的次数
+    uint64_t limitHits{0};     // 因全局上限无法从池中借用的次数
+
+    std::string toString() const;
+  };
+
+  /**
+   * @brief 在所属线程中创建
+   *
+   */
+  BufferPool();
+  ~BufferPool();
+
+  // noncopy
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  /**
+   * @brief 借用至少minSize字节的块；不在所属线程时退回堆分配，
+   * 超出全局上限时也从堆上分配
+   *
+   * @param minSize
+   * @return Block
+   */
+  Block acquire(size_t minSize);
+  /**
+   * @brief 同上，但需要新内存且会超出全局上限时返回空的Block
+   *
+   * @param minSize
+   * @return Block
+   */
+  Block tryAcquire(size_t minSize);
+  /**
+   * @brief 归还acquire得到的块，线程安全
+   *
+   * @param block
+   */
+  void release(const Block &block);
+
+  /**
+   * @brief 把本池中完全空闲的chunk还给堆，只能在所属线程调用
+   *
+   * @return size_t 归还的字节数
+   */
+  size_t trim();
+
+  /**
+   * @brief 本池的统计；线程安全
+   *
+   * @return Stats
+   */
+  Stats stats() const;
+
+  /**
+   * @brief 设置所有池从堆上申请的总字节数上限，0表示不限；线程安全
+   *
+   * @param bytes
+   */
+  static void setMemoryLimit(size_t bytes);
+  static size_t memoryLimit();
+  /**
+   * @brief 所有池的chunk和借出的堆上的块的总字节数
+   *
+   * @return size_t
+   */
+  static size_t totalPooledBytes();
+  /**
+   * @brief 总字节数是否已经达到全局上限
+   *
+   */
+  static bool overLimit();
+
+private:
+  /**
+   * @brief 从第index级借一块，需要新chunk且会超出全局上限时返回nullptr
+   *
+   * @param index
+   * @return void*
+   */
+  void *acquireFromClass(size_t index);
+  /**
+   * @brief 从堆上分配至少minSize字节的块并计入总字节数
+   *
+   * @param minSize
+   * @return Block
+   */
+  Block allocateHeap(size_t minSize);
+  /**
+   * @brief 第index级的空闲块达到m_trimAt时回收空闲chunk，只在所属线程调用
+   *
+   * @param index
+   */
+  void trimIdle(size_t index);
+  /**
+   * @brief 归还一个级别中的chunk之后更新统计
+   *
+   * @param index
+   * @param chunks
+   * @return size_t 归还的字节数
+   */
+  size_t chunksTrimmed(size_t index, size_t chunks);
+
+  SlabPool m_slabs[kClassCount];
+  // 每级空闲块数达到该值时回收，只在所属线程访问
+  size_t m_trimAt[kClassCount];
+  std::atomic<size_t> m_heapBytes{0};
+  std::atomic<size_t> m_trimmedBytes{0};
+  std::atomic<uint64_t> m_heapBlocks{0};
+  std::atomic<uint64_t> m_limitHits{0};
+};
+} // namespace neonet
+#endif // BUFFERPOOL_H_
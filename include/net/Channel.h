@@ -10,16 +10,30 @@
  */
 #ifndef CHANNEL_H
 #define CHANNEL_H
+#include "base/InplaceFunction.h"
+#include <cassert>
 #include <functional>
 #include <memory>
 #include <sys/epoll.h>
+#include <vector>
 namespace neonet {
 
+class Buffer;
 class EventLoop;
 
 class Channel {
 public:
-  using EventCallback = std::function<void()>;
+  using EventCallback = InplaceFunction<void()>;
+  /**
+   * @brief 完成模式下poller交给Channel的结果，在读回调中取走
+   *
+   */
+  struct Completions {
+    size_t received{0};        // 新追加到接收缓冲区的字节数
+    bool eof{false};           // 对端已关闭
+    int error{0};              // recv或accept失败时的errno
+    std::vector<int> accepted; // 新接受的连接fd
+  };
   Channel(EventLoop *loop, int fd);
   ~Channel();
 
@@ -39,23 +53,66 @@ public:
    *
    * @param cb
    */
-  void setReadCallback(const EventCallback &cb) { m_readCallback = cb; }
-  void setWriteCallback(const EventCallback &cb) { m_writeCallback = cb; }
-  void setCloseCallback(const EventCallback &cb) { m_closeCallback = cb; }
-  void setErrorCallback(const EventCallback &cb) { m_errorCallback = cb; }
+  void setReadCallback(EventCallback cb) { m_readCallback = std::move(cb); }
+  void setWriteCallback(EventCallback cb) { m_writeCallback = std::move(cb); }
+  void setCloseCallback(EventCallback cb) { m_closeCallback = std::move(cb); }
+  void setErrorCallback(EventCallback cb) { m_errorCallback = std::move(cb); }
 
   int fd() const { return m_fd; }
   int index() const { return m_index; }
   int events() const { return m_events; }
+  /**
+   * @brief 实际注册到epoll中的事件
+   *
+   * @details 水平触发时等于events()；边沿触发时只要没有disableAll，
+   * 就固定注册读写事件和EPOLLET，不随enable/disable改变
+   * @return int
+   */
+  int pollEvents() const;
+  int revents() const { return m_revents; }
   void set_revents(int revt) { m_revents = revt; }
   bool isNoneEvent() const { return m_events == kNoneEvent; }
   EventLoop *ownerLoop() { return m_loop; }
+  /**
+   * @brief 切换为边沿触发(EPOLLET)，必须在第一次enable之前调用
+   *
+   * @details
+   * 边沿触发时enable/disable读写只修改本地的关注标志，不再调用epoll_ctl，
+   * 未关注的事件不会分发给回调；回调必须一直读写到EAGAIN
+   */
+  void setEdgeTriggered() {
+    assert(!m_addedToLoop);
+    m_edgeTriggered = true;
+  }
+  bool isEdgeTriggered() const { return m_edgeTriggered; }
+  /**
+   * @brief 完成模式读取，只在EventLoop::completionIo()时生效
+   *
+   * @details 关注读事件期间，数据由poller直接收取(io_uring multishot
+   * recv)并追加到buffer中，读回调通过completions()得到收到的字节数、
+   * EOF和错误，不需要再调用read；传入nullptr时恢复为就绪通知，
+   * 已经添加到loop中时应该在收到数据之前切换
+   * @param buffer
+   */
+  void setCompletionRecv(Buffer *buffer);
+  /**
+   * @brief 完成模式接受连接，新连接的fd放在completions()->accepted中
+   *
+   * @param on
+   */
+  void setCompletionAccept(bool on = true) { m_completionAccept = on; }
+  Buffer *recvBuffer() const { return m_recvBuffer; }
+  bool completionRecv() const { return m_recvBuffer != nullptr; }
+  bool completionAccept() const { return m_completionAccept; }
+  bool completionMode() const { return completionRecv() || m_completionAccept; }
+  Completions *completions() { return &m_completions; }
   /**
    * @brief 开启或关闭事件，注意要更新到epoll中
    *
    */
   void enableReading() {
     m_events |= kReadEvent;
+    m_armed = true;
     update();
   }
   void disableReading() {
@@ -64,6 +121,7 @@ public:
   }
   void enableWriting() {
     m_events |= kWriteEvent;
+    m_armed = true;
     update();
   }
   void disableWriting() {
@@ -72,6 +130,7 @@ public:
   }
   void disableAll() {
     m_events = kNoneEvent;
+    m_armed = false;
     update();
   }
   void set_index(int idx) { m_index = idx; }
@@ -131,12 +190,16 @@ private:
   inline static constexpr const int kNoneEvent{0};
   inline static constexpr const int kReadEvent{EPOLLIN | EPOLLPRI};
   inline static constexpr const int kWriteEvent{EPOLLOUT};
+  // EPOLLET是最高位，需要显式转换为int
+  inline static constexpr const int kEdgeEvents{
+      static_cast<int>(kReadEvent | kWriteEvent | EPOLLRDHUP | EPOLLET)};
 
   EventLoop *m_loop; // 所属的事件循环
   const int m_fd;    // Channel操作的fd
   int m_index{-1};   // epoll_ctl操作状态机变化，kNew, kAdded, kDeleted
   int m_events{0};   // 关注的事件
   int m_revents{0};  // 实际发生的事件
+  int m_registeredEvents{0}; // 上一次注册到epoll的事件
   std::weak_ptr<void> m_tie; // 用于判断Channel是否已经被释放
   /**
    * @brief 判断标志
@@ -145,6 +208,11 @@ private:
   bool m_isTied{false};        // 是否被hold住
   bool m_eventHandling{false}; // 是否处于事件处理过程中
   bool m_addedToLoop{false};   // 是否已经添加到loop中
+  bool m_edgeTriggered{false}; // 是否边沿触发
+  bool m_armed{false};         // 边沿触发时是否注册在epoll中
+  bool m_completionAccept{false}; // 是否完成模式接受连接
+  Buffer *m_recvBuffer{nullptr};  // 完成模式读取的接收缓冲区
+  Completions m_completions;      // 完成模式的结果
   /**
    * @brief 事件回调函数
    *
@@ -0,0 +1,94 @@
+/**
+ * @file Connector.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 主动发起非阻塞连接，失败时按指数退避重试
+ * @version 0.1
+ * @date 2024-08-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CONNECTOR_H_
+#define CONNECTOR_H_
+#include "net/NetAddress.h"
+#include "net/TimerId.h"
+#include <functional>
+#include <memory>
+namespace neonet {
+class Channel;
+class EventLoop;
+
+class Connector : public std::enable_shared_from_this<Connector> {
+public:
+  using NewConnectionCallback = std::function<void(int sockfd)>;
+
+  Connector(EventLoop *loop, const NetAddress &serverAddr);
+  ~Connector();
+
+  // noncopy
+  Connector(const Connector &) = delete;
+  Connector &operator=(const Connector &) = delete;
+
+  void setNewConnectionCallback(const NewConnectionCallback &cb) {
+    m_newConnectionCallback = cb;
+  }
+  const NetAddress &serverAddress() const { return m_serverAddr; }
+
+  /**
+   * @brief 开始连接，线程安全
+   *
+   */
+  void start();
+  /**
+   * @brief 连接断开后重新连接，只能在loop线程中调用
+   *
+   */
+  void restart();
+  /**
+   * @brief 停止连接和重试，线程安全
+   *
+   */
+  void stop();
+
+private:
+  enum States { kDisconnected, kConnecting, kConnected };
+  inline static constexpr const double kInitRetryDelay{0.5}; // 秒
+  inline static constexpr const double kMaxRetryDelay{30.0};
+
+  void setState(States s) { m_state = s; }
+  void startInLoop();
+  void stopInLoop();
+  void connect();
+  /**
+   * @brief connect返回EINPROGRESS，等待socket可写
+   *
+   * @param sockfd
+   */
+  void connecting(int sockfd);
+  void handleWrite();
+  void handleError();
+  /**
+   * @brief 关闭sockfd，m_connect时在退避时间之后重试
+   *
+   * @param sockfd
+   */
+  void retry(int sockfd);
+  /**
+   * @brief 注销并释放Channel，返回其fd
+   *
+   * @return int
+   */
+  int removeAndResetChannel();
+
+  EventLoop *m_loop;
+  NetAddress m_serverAddr;
+  bool m_connect{false}; // 是否应该保持连接
+  States m_state{kDisconnected};
+  std::unique_ptr<Channel> m_channel; // 连接建立之前监听可写事件
+  NewConnectionCallback m_newConnectionCallback;
+  double m_retryDelay{kInitRetryDelay};
+  TimerId m_retryTimer;
+};
+using ConnectorPtr = std::shared_ptr<Connector>;
+} // namespace neonet
+#endif // CONNECTOR_H_
@@ -11,51 +11,31 @@
 #ifndef EPOLLER_H_
 #define EPOLLER_H_
 
-#include <map>
+#include "net/Poller.h"
+#include <cstdint>
 #include <sys/epoll.h>
 #include <vector>
 namespace neonet {
-class Channel;
-class EventLoop;
 
-class EPoller {
+class EPoller : public Poller {
 public:
-  using ChannelList = std::vector<Channel *>;
   EPoller(EventLoop *loop);
-  ~EPoller();
-  // noncopy
-  EPoller(const EPoller &) = delete;
-  EPoller &operator=(const EPoller &) = delete;
+  ~EPoller() override;
 
   /**
    * @brief 从epoll_wait返回的事件中填充活跃的Channel
    *
    * @param activeChannels
    */
-  void epoll(ChannelList *activeChannels);
+  void poll(ChannelList *activeChannels) override;
   /**
    * @brief 更新Channel中的事件，并改变channel的索引
    *
    * @param channel
    */
-  void updateChannel(Channel *channel);
-  /**
-   * @brief 移除Channel，只要无关注的事件就可以删除
-   *
-   * @param channel
-   */
-  void removeChannel(Channel *channel);
-  /**
-   * @brief 是否拥有Channel
-   *
-   * @param channel
-   */
-  bool hasChannel(Channel *channel) const;
-  /**
-   * @brief 判断是否是创建EventLoop的线程
-   *
-   */
-  void assertInLoopThread() const;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+  bool hasChannel(Channel *channel) const override;
 
 private:
   static const char *operationToString(int op);
@@ -73,16 +53,37 @@ private:
    * @param channel
    */
   void update(int operation, Channel *channel);
+  /**
+   * @brief 注册到epoll的数据：高32位是槽的版本号，低32位是fd
+   *
+   * @param fd
+   * @return uint64_t
+   */
+  uint64_t makeEventData(int fd) const {
+    return (static_cast<uint64_t>(m_channels[fd].generation) << 32) |
+           static_cast<uint32_t>(fd);
+  }
 
 private:
+  /**
+   * @brief fd对应的槽；fd每次注册或移除时版本号加一。
+   * EPOLL_CTL_DEL已经丢弃了fd未取出的事件，收集事件时比较版本号只是
+   * 防御性检查；同一批事件中被前面的回调移除的Channel由EventLoop跳过
+   *
+   */
+  struct ChannelSlot {
+    Channel *channel{nullptr};
+    uint32_t generation{0};
+  };
   using EventList = std::vector<struct epoll_event>;
-  using ChannelMap = std::map<int, Channel *>;
+  using ChannelTable = std::vector<ChannelSlot>;
 
   inline static const constexpr int kInitEventListSize{
-      16};                         // epoll_wait最多返回的事件数
-  ChannelMap m_channels;           // fd到Channel*的映射
-  EventLoop *m_ownerLoop{nullptr}; // 所属EventLoop
-  int m_epollFd{0};                // epoll_create1返回的fd
+      16}; // epoll_wait最多返回的事件数
+  inline static const constexpr size_t kInitChannelTableSize{
+      1024};                       // 初始的fd表大小，按需翻倍
+  ChannelTable m_channels; // 以fd为下标的Channel表
+  int m_epollFd{0};        // epoll_create1返回的fd
   EventList m_events; // 初始化为16个epoll_event，如果不够，会自动扩容
 };
 } // namespace neonet
@@ -12,18 +12,35 @@
 #ifndef EVENTLOOP_H_
 #define EVENTLOOP_H_
 
+#include "base/Callbacks.h"
+#include "base/InplaceFunction.h"
+#include "base/MpscQueue.h"
+#include "base/NodePool.h"
+#include "base/SlabPool.h"
+#include "base/Timestamp.h"
+#include "net/BufferPool.h"
+#include "net/LoopStats.h"
+#include "net/Poller.h"
+#include "net/TimerId.h"
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <thread>
+#include <vector>
 namespace neonet {
-class EPoller;
 class Channel;
+class TimerQueue;
+class TimingWheel;
 class EventLoop {
 public:
-  using Functor = std::function<void()>;
-  EventLoop();
+  // 不分配内存，捕获的内容超过容量时编译失败
+  using Functor = InplaceFunction<void()>;
+  /**
+   * @brief 在当前线程创建EventLoop
+   *
+   * @param backend IO多路复用后端，默认epoll(见Poller::defaultBackend)
+   */
+  explicit EventLoop(Poller::Backend backend = Poller::defaultBackend());
   ~EventLoop();
 
   // noncopy
@@ -55,8 +72,10 @@ public:
    */
   void runInLoop(Functor cb);
   /**
-   * @brief 将任务添加到任务队列中，唤醒EventLoop所在线程
+   * @brief 将任务添加到无锁任务队列中，必要时唤醒EventLoop所在线程
    *
+   * @details
+   * 两次epoll_wait之间的多次投递只写一次eventfd，由m_wakeupPending标志合并
    * @param cb
    */
   void queueInLoop(Functor cb);
@@ -67,14 +86,79 @@ public:
    */
   size_t queueSize() const;
 
+  /**
+   * @brief 在time时刻执行cb；线程安全
+   *
+   * @param time
+   * @param cb
+   * @return TimerId 用于cancel
+   */
+  TimerId runAt(Timestamp time, TimerCallback cb);
+  /**
+   * @brief delay秒后执行cb；线程安全
+   *
+   * @param delay
+   * @param cb
+   * @return TimerId
+   */
+  TimerId runAfter(double delay, TimerCallback cb);
+  /**
+   * @brief 每隔interval秒执行一次cb；线程安全
+   *
+   * @param interval
+   * @param cb
+   * @return TimerId
+   */
+  TimerId runEvery(double interval, TimerCallback cb);
+  /**
+   * @brief 取消定时器；线程安全
+   *
+   * @param timerId
+   */
+  void cancel(TimerId timerId);
+  /**
+   * @brief 该loop的分层时间轮，用于连接的空闲超时等大量O(1)定时项
+   *
+   * @return TimingWheel*
+   */
+  TimingWheel *timingWheel() { return m_timingWheel.get(); }
+  /**
+   * @brief 本loop的连接slab，TCPConnection连同shared_ptr控制块分配在
+   * 一个块中；只能在loop线程分配，任意线程释放
+   *
+   * @return const std::shared_ptr<SlabPool>&
+   */
+  const std::shared_ptr<SlabPool> &connectionSlab() const {
+    return m_connectionSlab;
+  }
+  /**
+   * @brief 本loop的缓冲区块池，连接的输入缓冲和输出缓冲链从中借用存储
+   *
+   * @return const std::shared_ptr<BufferPool>&
+   */
+  const std::shared_ptr<BufferPool> &bufferPool() const {
+    return m_bufferPool;
+  }
+
   /**
    * @brief 唤醒阻塞的EventLoop，向m_wakeupFd写入一个字节
    *
    */
   void wakeup();
   void updateChannel(Channel *channel);
+  /**
+   * @brief 从poller中移除Channel；在事件处理阶段调用时，同时把它在本批
+   * 活跃列表中的项置空，之后不会再分发给这个可能即将析构的Channel
+   *
+   * @param channel
+   */
   void removeChannel(Channel *channel);
   bool hasChannel(Channel *channel);
+  /**
+   * @brief 后端是否支持完成模式的读取和接受连接；创建后不变，线程安全
+   *
+   */
+  bool completionIo() const;
 
   /**
    * @brief 当前线程是否是创建EventLoop的线程
@@ -91,6 +175,45 @@ public:
     }
   }
 
+  /**
+   * @brief 运行统计，其他线程可以随时取快照
+   *
+   * @return const LoopStats&
+   */
+  const LoopStats &stats() const { return m_stats; }
+  /**
+   * @brief 供Poller记录统计，只能在loop线程调用
+   *
+   * @return LoopStats&
+   */
+  LoopStats &stats() { return m_stats; }
+
+  /**
+   * @brief 开启慢回调检测：单个Channel的handleEvent或单个任务耗时超过
+   * seconds时记录fd、事件和耗时；0表示关闭。线程安全
+   *
+   * @details 开启后每次分发多取一次时间
+   * @param seconds
+   */
+  void setSlowCallbackThreshold(double seconds);
+  /**
+   * @brief 本轮离开poll的单调时钟纳秒数，阻塞在poll中时为0；线程安全，
+   * 供LoopWatchdog判断loop是否停顿
+   *
+   * @return int64_t
+   */
+  int64_t busySince() const {
+    return m_busySince.load(std::memory_order_relaxed);
+  }
+  /**
+   * @brief 正在分发事件的fd，执行任务时为-1；线程安全
+   *
+   * @return int
+   */
+  int dispatchingFd() const {
+    return m_dispatchingFd.load(std::memory_order_relaxed);
+  }
+
   std::thread::id threadId() const { return m_threadId; }
   bool callingPendingFunctors() const { return m_callingPendingFunctors; }
   bool eventHandling() const { return m_eventHandling; }
@@ -102,7 +225,7 @@ private:
    */
   void abortNotInLoopThread();
   /**
-   * @brief 处理任务队列中的任务
+   * @brief 批量处理任务队列中的任务，只处理进入时已经入队的任务
    *
    */
   void doPendingFunctors();
@@ -111,9 +234,29 @@ private:
    *
    */
   void printActiveChannels() const; // DEBUG
+  /**
+   * @brief 开启慢回调检测时逐个计时地分发活跃Channel
+   *
+   * @param start 开始分发的时间
+   */
+  void handleEventsTimed(int64_t start);
+  void reportSlowCallback(const Channel *channel, int64_t nanos);
 
   using ChannelList = std::vector<Channel *>;
 
+  /**
+   * @brief 任务队列的侵入式节点
+   *
+   */
+  struct FunctorNode {
+    std::atomic<FunctorNode *> next{nullptr};
+    Functor functor;
+  };
+  // 每个loop预分配的任务节点数
+  inline static constexpr const size_t kFunctorPoolSize{1024};
+  // 连接slab的块在TCPConnection之外为shared_ptr控制块预留的字节数
+  inline static constexpr const size_t kControlBlockSlack{64};
+
 private:
   bool m_looping{false};                // 是否正在事件循环
   std::atomic<bool> m_quit{false};      // 是否已经退出
@@ -121,17 +264,31 @@ private:
   bool m_callingPendingFunctors{false}; // 是否正在执行任务队列中的任务
   std::thread::id m_threadId{std::this_thread::get_id()}; // 当前线程id
 
-  std::unique_ptr<EPoller> m_epoller; // epoll的封装
-  int m_wakeupFd;                     // 用于唤醒阻塞的eventloop
+  std::unique_ptr<Poller> m_poller;         // IO多路复用后端
+  std::unique_ptr<TimerQueue> m_timerQueue; // 基于timerfd的定时器队列
+  std::unique_ptr<TimingWheel> m_timingWheel; // 由m_timerQueue驱动的时间轮
+  int m_wakeupFd;                           // 用于唤醒阻塞的eventloop
   std::unique_ptr<Channel>
       m_wakeupChannel; // 唤醒channel，监听m_wakeupFd上的事件
 
   // scratch variables
-  ChannelList m_activeChannels;
+  ChannelList m_activeChannels; // 本批活跃的Channel，已移除的项为空
   Channel *m_currentActiveChannel{nullptr};
 
-  mutable std::mutex m_mutex;
-  std::vector<Functor> m_pendingFunctors; // @BuardedBy mutex_;
+  MpscQueue<FunctorNode> m_pendingFunctors; // 无锁任务队列，只有本线程出队
+  FunctorNode m_drainMarker;                // doPendingFunctors入队的分界节点
+  // 任务节点池，用完后才退回堆分配
+  NodePool<FunctorNode, kFunctorPoolSize> m_functorPool;
+  std::atomic<size_t> m_pendingCount{0};    // 队列中的任务数
+  std::atomic<bool> m_wakeupPending{false}; // 是否已有未处理的eventfd唤醒
+
+  // 连接的slab，由分配出去的连接共同持有，可能比loop活得久
+  std::shared_ptr<SlabPool> m_connectionSlab;
+  std::shared_ptr<BufferPool> m_bufferPool; // 同上，被借出的存储持有
+  LoopStats m_stats; // 运行统计
+  int64_t m_slowCallbackNanos{0}; // 慢回调的阈值，0表示不检测
+  std::atomic<int64_t> m_busySince{0};
+  std::atomic<int> m_dispatchingFd{-1};
 };
 
 } // namespace neonet
@@ -0,0 +1,61 @@
+/**
+ * @file EventLoopThread.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 运行一个EventLoop的线程，one loop per thread
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef EVENTLOOPTHREAD_H_
+#define EVENTLOOPTHREAD_H_
+#include "net/Poller.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+namespace neonet {
+class EventLoop;
+
+class EventLoopThread {
+public:
+  using ThreadInitCallback = std::function<void(EventLoop *)>;
+
+  explicit EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
+                           const std::string &name = std::string(),
+                           Poller::Backend backend = Poller::defaultBackend());
+  ~EventLoopThread();
+
+  // noncopy
+  EventLoopThread(const EventLoopThread &) = delete;
+  EventLoopThread &operator=(const EventLoopThread &) = delete;
+
+  /**
+   * @brief 启动线程，等待线程中的EventLoop创建完成后返回它
+   *
+   * @return EventLoop*
+   */
+  EventLoop *startLoop();
+  const std::string &name() const { return m_name; }
+
+private:
+  /**
+   * @brief 线程函数，在栈上创建EventLoop并运行事件循环
+   *
+   */
+  void threadFunc();
+
+private:
+  EventLoop *m_loop{nullptr}; // @GuardedBy m_mutex
+  bool m_exiting{false};
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  ThreadInitCallback m_callback; // 线程启动后、进入事件循环前调用
+  std::string m_name;
+  Poller::Backend m_backend; // 线程中EventLoop使用的后端
+};
+} // namespace neonet
+#endif // EVENTLOOPTHREAD_H_
@@ -0,0 +1,72 @@
+/**
+ * @file EventLoopThreadPool.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief EventLoop线程池，每个线程运行一个EventLoop
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef EVENTLOOPTHREADPOOL_H_
+#define EVENTLOOPTHREADPOOL_H_
+#include "net/EventLoopThread.h"
+#include <memory>
+#include <string>
+#include <vector>
+namespace neonet {
+class EventLoop;
+
+class EventLoopThreadPool {
+public:
+  using ThreadInitCallback = EventLoopThread::ThreadInitCallback;
+
+  EventLoopThreadPool(EventLoop *baseLoop, const std::string &name);
+  ~EventLoopThreadPool();
+
+  // noncopy
+  EventLoopThreadPool(const EventLoopThreadPool &) = delete;
+  EventLoopThreadPool &operator=(const EventLoopThreadPool &) = delete;
+
+  /**
+   * @brief 设置工作线程数，为0时所有连接都在baseLoop上处理
+   *
+   * @param numThreads
+   */
+  void setThreadNum(int numThreads) { m_numThreads = numThreads; }
+  /**
+   * @brief 设置工作EventLoop的后端，在start之前调用
+   *
+   * @param backend
+   */
+  void setPollerBackend(Poller::Backend backend) { m_backend = backend; }
+  void start(const ThreadInitCallback &cb = ThreadInitCallback());
+
+  /**
+   * @brief 轮询选择下一个工作EventLoop，必须在baseLoop线程调用
+   *
+   * @return EventLoop*
+   */
+  EventLoop *getNextLoop();
+  /**
+   * @brief 所有工作EventLoop，没有工作线程时只有baseLoop
+   *
+   * @return std::vector<EventLoop *>
+   */
+  std::vector<EventLoop *> getAllLoops();
+
+  bool started() const { return m_started; }
+  const std::string &name() const { return m_name; }
+
+private:
+  EventLoop *m_baseLoop; // 接受连接的EventLoop
+  std::string m_name;
+  bool m_started{false};
+  int m_numThreads{0};
+  Poller::Backend m_backend{Poller::defaultBackend()};
+  size_t m_next{0}; // 下一个分配连接的EventLoop下标
+  std::vector<std::unique_ptr<EventLoopThread>> m_threads;
+  std::vector<EventLoop *> m_loops;
+};
+} // namespace neonet
+#endif // EVENTLOOPTHREADPOOL_H_
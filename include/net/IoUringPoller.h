@@ -0,0 +1,199 @@
+/**
+ * @file IoUringPoller.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 基于io_uring的Poller，直接使用系统调用，不依赖liburing
+ * @version 0.1
+ * @date 2024-08-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 一轮poll中产生的所有请求(注册、修改、取消)先放在提交队列里，和等待一起
+ * 由一次io_uring_enter提交，代替epoll的每次修改一次epoll_ctl。
+ * - 水平触发的Channel使用单次poll，分发之后的下一轮重新提交，语义与epoll相同
+ * - 边沿触发的Channel使用multishot poll，只提交一次
+ * - 完成模式的Channel使用multishot recv/accept，数据由内核收取到注册的
+ *   缓冲区环(provided buffer ring)中，拷贝到Channel的接收缓冲区后立即归还，
+ *   省去每次可读事件之后的read系统调用
+ * 每个请求的user_data是(操作<<56 | 注册代数<<40 | 请求序号<<32 | fd)，
+ * 注册代数不同的完成事件属于已经移除的Channel，直接丢弃
+ *
+ */
+#ifndef IOURINGPOLLER_H_
+#define IOURINGPOLLER_H_
+
+#include "net/Poller.h"
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <vector>
+namespace neonet {
+
+class IoUringPoller : public Poller {
+public:
+  explicit IoUringPoller(EventLoop *loop);
+  ~IoUringPoller() override;
+
+  /**
+   * @brief io_uring是否创建成功
+   *
+   */
+  bool valid() const { return m_ringFd >= 0; }
+
+  /**
+   * @brief 提交本轮积累的请求并等待至少一个完成事件
+   *
+   * @param activeChannels
+   */
+  void poll(ChannelList *activeChannels) override;
+  /**
+   * @brief 记录Channel需要同步，在下一次poll时生成请求
+   *
+   * @param channel
+   */
+  void updateChannel(Channel *channel) override;
+  /**
+   * @brief 取消Channel上在途的请求并移除
+   *
+   * @param channel
+   */
+  void removeChannel(Channel *channel) override;
+  bool hasChannel(Channel *channel) const override;
+  bool completionIo() const override { return m_completionIo; }
+
+private:
+  /**
+   * @brief 请求的类型，放在user_data的最高字节
+   *
+   */
+  enum Op : uint8_t { kNoOp, kPoll, kRecv, kAccept, kCancel };
+
+  /**
+   * @brief fd对应的槽
+   *
+   */
+  struct ChannelSlot {
+    Channel *channel{nullptr};
+    uint16_t generation{0}; // 每次注册或移除加一
+    uint8_t sequence{0};    // 每次提交新请求加一
+    bool pending{false};    // 是否在m_pending中
+    uint32_t pollMask{0};   // 在途poll请求关注的事件
+    uint64_t pollData{0};   // 在途poll请求的user_data，0表示没有
+    uint64_t readData{0};   // 在途recv/accept请求的user_data
+    uint64_t activeRound{0}; // 最后一次被加入activeChannels的轮次
+  };
+  using ChannelTable = std::vector<ChannelSlot>;
+
+  /**
+   * @brief 按Channel当前关注的事件生成或取消请求
+   *
+   * @param fd
+   */
+  void sync(int fd);
+  /**
+   * @brief 处理一个完成事件
+   *
+   * @param cqe
+   * @param activeChannels
+   */
+  void handleCompletion(const struct io_uring_cqe &cqe,
+                        ChannelList *activeChannels);
+  void handlePoll(ChannelSlot *slot, const struct io_uring_cqe &cqe,
+                  bool current, ChannelList *activeChannels);
+  void handleRecv(ChannelSlot *slot, const struct io_uring_cqe &cqe,
+                  bool current, ChannelList *activeChannels);
+  void handleAccept(ChannelSlot *slot, const struct io_uring_cqe &cqe,
+                    bool current, ChannelList *activeChannels);
+  /**
+   * @brief 释放不再属于任何Channel的完成事件占用的资源
+   *
+   * @param cqe
+   */
+  void discard(const struct io_uring_cqe &cqe);
+  /**
+   * @brief 将revents合并到Channel上，每轮只加入activeChannels一次
+   *
+   */
+  void activate(ChannelSlot *slot, int revents, ChannelList *activeChannels);
+  /**
+   * @brief 内核不支持完成模式时，Channel退回就绪通知
+   *
+   * @param slot
+   */
+  void disableCompletion(ChannelSlot *slot);
+  void markPending(int fd);
+
+  /**
+   * @brief 取得一个空闲的提交项，提交队列满时先提交
+   *
+   * @return struct io_uring_sqe*
+   */
+  struct io_uring_sqe *getSqe();
+  uint64_t makeData(Op op, int fd, ChannelSlot *slot);
+  void submitPoll(int fd, uint64_t data, uint32_t mask, bool multishot);
+  void submitRecv(int fd, uint64_t data);
+  void submitAccept(int fd, uint64_t data);
+  void submitCancel(uint64_t target);
+  /**
+   * @brief io_uring_enter的封装，提交所有未提交的请求
+   *
+   * @param minComplete 等待的完成事件数，0表示不等待
+   * @return int
+   */
+  int enter(unsigned minComplete);
+
+  bool setupRing();
+  bool setupBufferRing();
+  void recycleBuffer(uint16_t bid);
+
+private:
+  /**
+   * @brief 与内核共享的提交队列和完成队列
+   *
+   */
+  struct SubmissionQueue {
+    unsigned *head{nullptr};
+    unsigned *tail{nullptr};
+    unsigned *array{nullptr};
+    unsigned mask{0};
+    unsigned entries{0};
+    struct io_uring_sqe *sqes{nullptr};
+  };
+  struct CompletionQueue {
+    unsigned *head{nullptr};
+    unsigned *tail{nullptr};
+    unsigned mask{0};
+    struct io_uring_cqe *cqes{nullptr};
+  };
+
+  inline static constexpr const unsigned kRingEntries{1024};
+  inline static constexpr const unsigned kCqEntries{4 * kRingEntries};
+  inline static constexpr const size_t kInitChannelTableSize{1024};
+  // 缓冲区环：kBufferCount个kBufferSize字节的缓冲区，组号kBufferGroup
+  inline static constexpr const unsigned kBufferCount{256};
+  inline static constexpr const unsigned kBufferSize{16 * 1024};
+  inline static constexpr const uint16_t kBufferGroup{0};
+
+  int m_ringFd{-1};
+  void *m_ringMem{nullptr}; // 提交队列和完成队列的映射
+  size_t m_ringMemSize{0};
+  void *m_cqMem{nullptr}; // 内核不支持单次映射时完成队列的映射
+  size_t m_cqMemSize{0};
+  void *m_sqesMem{nullptr};
+  size_t m_sqesMemSize{0};
+  SubmissionQueue m_sq;
+  CompletionQueue m_cq;
+  unsigned m_sqTail{0}; // 本地的提交队列尾，提交时写回内核
+
+  struct io_uring_buf *m_bufRing{nullptr}; // 注册到内核的缓冲区环
+  char *m_buffers{nullptr};                // 缓冲区环中的缓冲区
+  uint16_t m_bufTail{0};                   // 本地的缓冲区环尾
+  bool m_completionIo{false};              // 是否支持完成模式
+
+  ChannelTable m_channels;  // 以fd为下标的Channel表
+  std::vector<int> m_pending; // 等待sync的fd
+  uint64_t m_round{0};        // poll的轮次
+};
+} // namespace neonet
+
+#endif // IOURINGPOLLER_H_
@@ -0,0 +1,138 @@
+/**
+ * @file LoopStats.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief EventLoop的运行统计：唤醒次数、每次唤醒的事件数、回调耗时、任务队列深度
+ * @version 0.1
+ * @date 2024-08-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 只有loop线程写，每个计数器是单独的原子变量，写入用relaxed的load+store，
+ * 不需要锁和原子读改写指令；其他线程随时可以用snapshot读取，
+ * 各计数器之间可能相差正在进行的一轮循环。
+ * 两次快照相减得到这段时间内的增量，据此判断loop忙于IO(eventNanos)、
+ * 执行任务(functorNanos)，还是被其他线程投递的任务淹没(functors、
+ * pendingHighWater)
+ *
+ */
+#ifndef LOOPSTATS_H_
+#define LOOPSTATS_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <time.h>
+namespace neonet {
+class alignas(64) LoopStats {
+public:
+  /**
+   * @brief 某一时刻的统计值
+   *
+   */
+  struct Snapshot {
+    int64_t timeNanos{0};          // 取快照的单调时钟时间
+    uint64_t polls{0};             // poll(epoll_wait)的次数
+    uint64_t events{0};            // poll返回的活跃Channel总数
+    uint64_t pollNanos{0};         // 阻塞在poll中的时间
+    uint64_t eventNanos{0};        // 执行handleEvent的时间
+    uint64_t functorNanos{0};      // 执行doPendingFunctors的时间
+    uint64_t functors{0};          // 执行的任务数
+    uint64_t eventListResizes{0};  // poll事件数组扩容的次数
+    uint64_t slowCallbacks{0};     // 超过耗时预算的回调数(见看门狗)
+    uint64_t maxEventsPerPoll{0};  // 单次poll最多的活跃Channel数，自创建起
+    uint64_t pendingHighWater{0};  // 任务队列的最大深度，自创建起
+
+    /**
+     * @brief 与更早的快照的差；两个最大值不能相减，保留本快照的值
+     *
+     * @param earlier
+     * @return Snapshot
+     */
+    Snapshot operator-(const Snapshot &earlier) const;
+    double eventsPerPoll() const {
+      return polls == 0 ? 0.0 : static_cast<double>(events) / polls;
+    }
+    /**
+     * @brief 一行可读的描述，时间为毫秒
+     *
+     * @return std::string
+     */
+    std::string toString() const;
+  };
+
+  LoopStats() = default;
+  // noncopy
+  LoopStats(const LoopStats &) = delete;
+  LoopStats &operator=(const LoopStats &) = delete;
+
+  /**
+   * @brief 读取当前的统计值；线程安全
+   *
+   * @return Snapshot
+   */
+  Snapshot snapshot() const;
+
+  // 以下由loop线程调用
+  void addPoll(size_t events, int64_t nanos) {
+    add(m_polls, 1);
+    add(m_events, events);
+    add(m_pollNanos, static_cast<uint64_t>(nanos));
+    raise(m_maxEventsPerPoll, events);
+  }
+  void addEventHandling(int64_t nanos) {
+    add(m_eventNanos, static_cast<uint64_t>(nanos));
+  }
+  /**
+   * @brief 记录一次doPendingFunctors执行的任务
+   *
+   * @param count 执行的任务数
+   * @param pending 开始时队列中的任务数
+   */
+  void addFunctors(size_t count, size_t pending) {
+    add(m_functors, count);
+    raise(m_pendingHighWater, pending);
+  }
+  void addFunctorTime(int64_t nanos) {
+    add(m_functorNanos, static_cast<uint64_t>(nanos));
+  }
+  void addEventListResize() { add(m_eventListResizes, 1); }
+  void addSlowCallback() { add(m_slowCallbacks, 1); }
+
+  /**
+   * @brief 纳秒精度的单调时钟
+   *
+   * @return int64_t
+   */
+  static int64_t nowNanos() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+private:
+  using Counter = std::atomic<uint64_t>;
+
+  static void add(Counter &counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+  static void raise(Counter &counter, uint64_t value) {
+    if (value > counter.load(std::memory_order_relaxed)) {
+      counter.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  Counter m_polls{0};
+  Counter m_events{0};
+  Counter m_pollNanos{0};
+  Counter m_eventNanos{0};
+  Counter m_functorNanos{0};
+  Counter m_functors{0};
+  Counter m_eventListResizes{0};
+  Counter m_slowCallbacks{0};
+  Counter m_maxEventsPerPoll{0};
+  Counter m_pendingHighWater{0};
+};
+} // namespace neonet
+#endif // LOOPSTATS_H_
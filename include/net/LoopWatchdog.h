@@ -0,0 +1,93 @@
+/**
+ * @file LoopWatchdog.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 停顿检测：独立的监控线程定期检查各EventLoop是否长时间没有回到poll
+ * @version 0.1
+ * @date 2024-08-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * EventLoop离开poll时记录时间(EventLoop::busySince)，回到poll时清零。
+ * 监控线程每checkInterval秒检查一次，离开poll超过stallThreshold秒的loop
+ * 记为一次停顿，连同正在分发的fd交给停顿回调(默认写WARN日志)；
+ * 同一次停顿只报告一次
+ *
+ */
+#ifndef LOOPWATCHDOG_H_
+#define LOOPWATCHDOG_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace neonet {
+class EventLoop;
+
+class LoopWatchdog {
+public:
+  /**
+   * @brief 停顿回调，在监控线程中持有内部锁调用，不能再调用watch/unwatch
+   *
+   * @param loop 停顿的loop
+   * @param seconds 已经停顿的秒数
+   * @param fd 正在分发事件的fd，执行任务时为-1
+   */
+  using StallCallback =
+      std::function<void(EventLoop *loop, double seconds, int fd)>;
+
+  /**
+   * @param stallThreshold 离开poll超过多少秒算作停顿
+   * @param checkInterval 检查间隔，默认为stallThreshold的一半
+   */
+  explicit LoopWatchdog(double stallThreshold, double checkInterval = 0.0);
+  ~LoopWatchdog();
+  // noncopy
+  LoopWatchdog(const LoopWatchdog &) = delete;
+  LoopWatchdog &operator=(const LoopWatchdog &) = delete;
+
+  /**
+   * @brief 开始监控loop；线程安全，loop需要在unwatch或stop之前保持有效
+   *
+   * @param loop
+   */
+  void watch(EventLoop *loop);
+  void unwatch(EventLoop *loop);
+  void setStallCallback(StallCallback cb);
+
+  void start();
+  void stop();
+  /**
+   * @brief 累计报告的停顿次数
+   *
+   * @return uint64_t
+   */
+  uint64_t stalls() const { return m_stalls.load(std::memory_order_relaxed); }
+
+private:
+  /**
+   * @brief 被监控的loop和已经报告过的停顿的起始时间
+   *
+   */
+  struct Entry {
+    EventLoop *loop;
+    int64_t reportedSince{0};
+  };
+
+  void threadFunc();
+  void check(int64_t now);
+
+  const int64_t m_stallNanos;
+  const int64_t m_intervalNanos;
+  std::thread m_thread;
+  std::mutex m_mutex; // 保护以下成员
+  std::condition_variable m_cond;
+  bool m_running{false};
+  std::vector<Entry> m_entries;
+  StallCallback m_stallCallback;
+  std::atomic<uint64_t> m_stalls{0};
+};
+} // namespace neonet
+#endif // LOOPWATCHDOG_H_
@@ -22,10 +22,6 @@ public:
   explicit NetAddress(const sockaddr_in &addr);
   ~NetAddress() = default;
 
-  // nocopy
-  NetAddress(const NetAddress &addr) = delete;
-  NetAddress &operator=(const NetAddress &addr) = delete;
-
 public:
   const struct sockaddr_in &getAddr() const { return m_addr; }
   const socklen_t getAddrLen() const { return m_addr_len; }
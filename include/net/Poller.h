@@ -0,0 +1,94 @@
+/**
+ * @file Poller.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief IO多路复用的抽象接口，EPoller和IoUringPoller是它的两种实现
+ * @version 0.1
+ * @date 2024-08-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef POLLER_H_
+#define POLLER_H_
+
+#include <memory>
+#include <vector>
+namespace neonet {
+class Channel;
+class EventLoop;
+
+class Poller {
+public:
+  using ChannelList = std::vector<Channel *>;
+  /**
+   * @brief 可选的后端
+   *
+   * kEpoll: 就绪通知，默认
+   * kIoUring: io_uring，支持时读取和接受连接由内核直接完成
+   */
+  enum Backend { kEpoll, kIoUring };
+
+  explicit Poller(EventLoop *loop) : m_ownerLoop(loop) {}
+  virtual ~Poller() = default;
+
+  // noncopy
+  Poller(const Poller &) = delete;
+  Poller &operator=(const Poller &) = delete;
+
+  /**
+   * @brief 等待事件，将活跃的Channel填充到activeChannels中
+   *
+   * @param activeChannels
+   */
+  virtual void poll(ChannelList *activeChannels) = 0;
+  /**
+   * @brief 更新Channel关注的事件，第一次调用时注册Channel
+   *
+   * @param channel
+   */
+  virtual void updateChannel(Channel *channel) = 0;
+  /**
+   * @brief 移除Channel，只要无关注的事件就可以删除
+   *
+   * @param channel
+   */
+  virtual void removeChannel(Channel *channel) = 0;
+  /**
+   * @brief 是否拥有Channel
+   *
+   * @param channel
+   */
+  virtual bool hasChannel(Channel *channel) const = 0;
+  /**
+   * @brief 是否支持完成模式的读取和接受连接，见Channel::setCompletionRecv
+   *
+   */
+  virtual bool completionIo() const { return false; }
+  /**
+   * @brief 判断是否是创建EventLoop的线程
+   *
+   */
+  void assertInLoopThread() const;
+
+  /**
+   * @brief 创建指定后端的Poller；io_uring不可用时退回epoll
+   *
+   * @param loop
+   * @param backend
+   * @return std::unique_ptr<Poller>
+   */
+  static std::unique_ptr<Poller> newPoller(EventLoop *loop, Backend backend);
+  /**
+   * @brief 默认后端，设置环境变量NEONET_POLLER=io_uring时为kIoUring，
+   * 方便不重新编译就在同一负载上对比两种后端
+   *
+   * @return Backend
+   */
+  static Backend defaultBackend();
+
+protected:
+  EventLoop *m_ownerLoop; // 所属EventLoop
+};
+} // namespace neonet
+
+#endif // POLLER_H_
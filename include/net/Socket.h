@@ -64,33 +64,35 @@ public:
    * @return int
    */
   int shutdownWrite();
-
-private:
   /**
-   * @brief Set the Reuse Addr object，解决time_wait问题
+   * @brief 开启或关闭Nagle算法，on为true时允许小包立即发送
    *
+   * @param on
    * @return int
    */
-  int setReuseAddr();
+  int setNoDelay(bool on = true);
   /**
-   * @brief Set the Reuse Port object，解决惊群问题
+   * @brief 开启或关闭TCP保活
    *
+   * @param on
    * @return int
    */
-  int setReusePort();
-  int setNonblock();
+  int setKeepAlive(bool on = true);
+
+private:
   /**
-   * @brief 关闭Nagle算法，允许小包的发送。
+   * @brief Set the Reuse Addr object，解决time_wait问题
    *
    * @return int
    */
-  int setNoDelay();
+  int setReuseAddr();
   /**
-   * @brief Set the Keep Alive object
+   * @brief Set the Reuse Port object，解决惊群问题
    *
    * @return int
    */
-  int setKeepAlive();
+  int setReusePort();
+  int setNonblock();
 
 private:
   int m_sockfd{-1}; // 套接字描述符
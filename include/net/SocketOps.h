@@ -28,6 +28,8 @@ int accept(int sockfd, struct sockaddr_in *addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+ssize_t sendfile(int sockfd, int fileFd, off_t *offset, size_t count);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
@@ -50,6 +52,13 @@ void toIp(char *buf, size_t size, const struct sockaddr *addr);
 void fromIpPort(const char *ip, uint16_t port, struct sockaddr_in *addr);
 
 int getSocketError(int sockfd);
+/**
+ * @brief 接收队列中还未读取的字节数(FIONREAD)
+ *
+ * @param sockfd
+ * @return int 出错时返回-1
+ */
+int bytesAvailable(int sockfd);
 
 /**
  * @brief
@@ -0,0 +1,88 @@
+/**
+ * @file SplicePipe.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 用于splice转发的管道，数据在内核中从一个socket移动到另一个socket
+ * @version 0.1
+ * @date 2024-08-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 源连接在自己的loop中把socket中的数据splice进管道，目的连接在自己的loop中
+ * 把管道中的数据splice到socket，两端可以在不同线程；管道是先进先出的，
+ * 只要一个管道只有一个目的连接，数据的顺序就不会乱。管道满时源连接暂停读取，
+ * 目的连接取走数据后通过可写回调通知源连接继续
+ *
+ */
+#ifndef SPLICEPIPE_H_
+#define SPLICEPIPE_H_
+#include "base/InplaceFunction.h"
+#include <atomic>
+#include <cstddef>
+#include <sys/types.h>
+namespace neonet {
+class SplicePipe {
+public:
+  using WritableCallback = InplaceFunction<void()>;
+  inline static constexpr const size_t kDefaultPipeSize{256 * 1024};
+
+  /**
+   * @brief 创建非阻塞管道，并尝试把容量设置为pipeSize
+   *
+   * @param pipeSize 设置失败时保留系统默认容量
+   */
+  explicit SplicePipe(size_t pipeSize = kDefaultPipeSize);
+  ~SplicePipe();
+
+  // noncopy
+  SplicePipe(const SplicePipe &) = delete;
+  SplicePipe &operator=(const SplicePipe &) = delete;
+
+  bool valid() const { return m_readFd >= 0; }
+
+  /**
+   * @brief 从fd移动最多len字节到管道
+   *
+   * @param fd
+   * @param len
+   * @param savedErrno 出错时保存的errno
+   * @return ssize_t splice的返回值，0表示对端关闭
+   */
+  ssize_t spliceFrom(int fd, size_t len, int *savedErrno);
+  /**
+   * @brief 从管道移动最多len字节到fd，有源连接在等待时回调可写函数
+   *
+   * @param fd
+   * @param len
+   * @param savedErrno 出错时保存的errno
+   * @return ssize_t splice的返回值
+   */
+  ssize_t spliceTo(int fd, size_t len, int *savedErrno);
+  /**
+   * @brief 丢弃管道中的len字节，目的连接关闭时使用
+   *
+   * @param len
+   */
+  void discard(size_t len);
+
+  /**
+   * @brief 管道满时源连接设置等待标志，之后第一次取走数据时回调cb
+   *
+   * @details 回调在目的连接的线程中执行，需要自己转到源连接的loop
+   * @param cb
+   */
+  void setWritableCallback(WritableCallback cb) {
+    m_writableCallback = std::move(cb);
+  }
+  void setWriterWaiting(bool on) { m_writerWaiting.store(on); }
+
+private:
+  void notifyWritable();
+
+  int m_readFd{-1};
+  int m_writeFd{-1};
+  std::atomic<bool> m_writerWaiting{false}; // 源连接是否因管道满暂停
+  WritableCallback m_writableCallback;
+};
+} // namespace neonet
+#endif // SPLICEPIPE_H_
@@ -11,17 +11,22 @@
 #ifndef TCPCONNECTION_H_
 #define TCPCONNECTION_H_
 #include "base/Callbacks.h"
+#include "base/InplaceFunction.h"
 #include "net/Buffer.h"
+#include "net/BufferChain.h"
+#include "net/Channel.h"
 #include "net/NetAddress.h"
+#include "net/Socket.h"
+#include "net/TimingWheel.h"
+#include <any>
 #include <cstddef>
 #include <memory>
 #include <string>
 namespace neonet {
-class Channel;
 class EventLoop;
-class Socket;
+class SplicePipe;
 
-class TCPConnection : public std::enable_shared_from_this<TcpConnection> {
+class TCPConnection : public std::enable_shared_from_this<TCPConnection> {
 public:
   TCPConnection(EventLoop *loop, const std::string &name, int sockfd,
                 const NetAddress &localAddr, const NetAddress &peerAddr);
@@ -39,37 +44,158 @@ public:
   bool disconnected() const { return m_state == kDisconnected; }
 
   void send(const void *message, int len);
+  /**
+   * @brief 发送message中的可读数据并清空message，线程安全
+   *
+   * @details 线性存储整个移交给输出缓冲链，不拷贝；环形存储留在message中，
+   * 只拷贝其中的数据
+   * @param message
+   */
   void send(Buffer *message);
+  /**
+   * @brief 发送文件fd中从offset开始的length字节，线程安全
+   *
+   * @details 复制一份fd交给输出缓冲链，调用方可以立即关闭fd；
+   * 文件区域与前后send的数据按调用顺序发送，可写时每次sendfile一块，
+   * 数据不经过用户空间。每写出一块回调FileProgressCallback报告进度；
+   * 和其他数据一样，整个输出缓冲链写完时回调WriteCompleteCallback。
+   * sendfile出错或者文件在发送完之前被截断时强制关闭连接
+   * @param fd
+   * @param offset
+   * @param length
+   * @return false 连接未建立或者复制fd失败
+   */
+  bool sendFile(int fd, off_t offset, size_t length);
   void shutdown();
   void forceClose();
   void setTcpNoDelay(bool on);
   void startRead();
   void stopRead();
   bool isReading() const { return m_reading; }
+  /**
+   * @brief 计数式的暂停读取，线程安全；计数从0变为1时停止读取，
+   * unthrottleRead把计数减回0时恢复读取
+   *
+   * @details 供多个下游对同一个上游施加背压。两者总是排入所属loop的任务
+   * 队列执行，同一线程先后发出的暂停和恢复不会乱序；
+   * 与stopRead/startRead不共用计数，混用时以最后执行的为准
+   */
+  void throttleRead();
+  void unthrottleRead();
+  /**
+   * @brief 设置空闲超时，seconds秒内没有收到数据就forceClose；0表示不超时
+   *
+   * @details 超时项挂在所属loop的时间轮上，每次收到数据只刷新deadline
+   * @param seconds
+   */
+  void setIdleTimeout(double seconds);
+  /**
+   * @brief 使用边沿触发，只能在connectEstablished之前调用
+   *
+   * @details 读写都会循环到EAGAIN，开关读写不再调用epoll_ctl；
+   * 一次读事件最多连续读kMaxReadsPerEvent次，剩下的放到下一轮继续读
+   */
+  void setEdgeTriggered();
+  bool isEdgeTriggered() const;
+  /**
+   * @brief 开启splice转发，用户空间只读取headerLength字节的报头
+   *
+   * @details 每读满一个报头调用一次消息回调，回调解析报头之后用spliceTo
+   * 指定报文体的去向，报文体经由管道在内核中移动到目的连接，不拷贝到Buffer。
+   * 应该在连接回调中调用，完成模式的读取会退回就绪通知
+   * @param headerLength 0表示关闭
+   */
+  void setSpliceHeaderLength(size_t headerLength);
+  /**
+   * @brief 输入缓冲改用memfd双重映射的环形存储，只能在所属loop中调用
+   *
+   * @details 适合持续大流量的连接：可读数据总是连续的，读取时不再把数据
+   * 挪到缓冲区前面，每次读只用一个iovec；环形存储不从BufferPool借用，
+   * 连接空闲时也一直占用capacity字节
+   * @param capacity
+   * @return true
+   * @return false 映射失败，继续使用原来的存储
+   */
+  bool setMirroredInputBuffer(size_t capacity = Buffer::kMirroredSize);
+  /**
+   * @brief 把接下来的len字节报文体转发给dst，只能在消息回调中调用
+   *
+   * @details 已经在输入缓冲区中的部分直接send，其余部分splice转发；
+   * dst可以属于其他loop，为空时丢弃报文体
+   * @param dst
+   * @param len
+   */
+  void spliceTo(const TcpConnectionPtr &dst, size_t len);
+  /**
+   * @brief 发送管道中已有的len字节，线程安全；连接已经关闭时丢弃这些字节
+   *
+   * @param pipe
+   * @param len
+   */
+  void sendPipe(const std::shared_ptr<SplicePipe> &pipe, size_t len);
 
-  void setConnectionCallback(const ConnectionCallback &cb) {
-    m_connectionCallback = cb;
+  /**
+   * @brief 设置回调，cb可以是std::function或lambda，都存放在连接内部
+   *
+   * @param cb
+   */
+  template <typename F> void setConnectionCallback(F &&cb) {
+    m_connectionCallback = std::forward<F>(cb);
   }
 
-  void setMessageCallback(const MessageCallback &cb) { m_messageCallback = cb; }
+  template <typename F> void setMessageCallback(F &&cb) {
+    m_messageCallback = std::forward<F>(cb);
+  }
 
-  void setWriteCompleteCallback(const WriteCompleteCallback &cb) {
-    m_writeCompleteCallback = cb;
+  template <typename F> void setWriteCompleteCallback(F &&cb) {
+    m_writeCompleteCallback = std::forward<F>(cb);
   }
 
-  void setHighWaterMarkCallback(const HighWaterMarkCallback &cb,
-                                size_t highWaterMark) {
-    m_highWaterMarkCallback = cb;
+  template <typename F>
+  void setHighWaterMarkCallback(F &&cb, size_t highWaterMark) {
+    m_highWaterMarkCallback = std::forward<F>(cb);
     m_highWaterMark = highWaterMark;
   }
+  /**
+   * @brief 输出缓冲链达到高水位之后，写出到不超过lowWaterMark字节时回调一次
+   *
+   * @details 与高水位回调成对出现，用于恢复被暂停的上游；
+   * lowWaterMark应小于高水位，0表示写完时回调
+   * @param cb
+   * @param lowWaterMark
+   */
+  template <typename F>
+  void setLowWaterMarkCallback(F &&cb, size_t lowWaterMark) {
+    m_lowWaterMarkCallback = std::forward<F>(cb);
+    m_lowWaterMark = lowWaterMark;
+  }
+  /**
+   * @brief sendFile的区域每写出一块回调一次，参数为该区域已发送的字节数
+   * 和总字节数，两者相等时该区域发送完毕
+   *
+   * @param cb
+   */
+  template <typename F> void setFileProgressCallback(F &&cb) {
+    m_fileProgressCallback = std::forward<F>(cb);
+  }
+
+  /**
+   * @brief 用户附加在连接上的数据
+   *
+   */
+  void setContext(const std::any &context) { m_context = context; }
+  const std::any &getContext() const { return m_context; }
+  std::any *getMutableContext() { return &m_context; }
 
   /// Advanced interface
   Buffer *inputBuffer() { return &m_inputBuffer; }
 
-  Buffer *outputBuffer() { return &m_outputBuffer; }
+  BufferChain *outputBuffer() { return &m_outputBuffer; }
 
   /// Internal use only.
-  void setCloseCallback(const CloseCallback &cb) { m_closeCallback = cb; }
+  template <typename F> void setCloseCallback(F &&cb) {
+    m_closeCallback = std::forward<F>(cb);
+  }
 
   // called when TcpServer accepts a new connection
   void connectEstablished(); // should be called only once
@@ -78,8 +204,102 @@ public:
 
 private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+  inline static constexpr const int kMaxReadsPerEvent{16};
+  // 退回拷贝时每次读取的最大字节数
+  inline static constexpr const size_t kSpliceCopySize{64 * 1024};
+  // 缓冲内存达到全局上限时，暂停读取多少秒之后重试
+  inline static constexpr const double kBufferRetryDelay{0.01};
 
+  /**
+   * @brief Channel上的事件回调
+   *
+   */
+  void handleRead();
+  /**
+   * @brief 完成模式的读回调，数据已经由poller追加到m_inputBuffer中
+   *
+   */
+  void handleRecvCompletions();
+  /**
+   * @brief splice转发模式的读回调，交替读取报头和转发报文体
+   *
+   */
+  void handleSpliceRead();
+  /**
+   * @brief 读取报头，读满时调用消息回调
+   *
+   * @param savedErrno
+   * @return ssize_t read的返回值
+   */
+  ssize_t readSpliceHeader(int *savedErrno);
+  /**
+   * @brief 把报文体splice进管道并交给目的连接；管道满时暂停读取
+   *
+   * @param savedErrno
+   * @return ssize_t splice的返回值
+   */
+  ssize_t spliceBody(int *savedErrno);
+  /**
+   * @brief 无法使用管道或目的连接已经关闭时，读出报文体再send
+   *
+   * @param savedErrno
+   * @return ssize_t read的返回值
+   */
+  ssize_t copyBody(int *savedErrno);
+  /**
+   * @brief 目的连接取走管道中的数据后，恢复因管道满而暂停的读取
+   *
+   */
+  void resumeSplice();
+  void handleWrite();
+  void handleClose();
+  void handleError();
+  /**
+   * @brief 先尝试直接写socket，写不完的部分追加到输出缓冲链
+   *
+   * @param message
+   * @param len
+   */
   void sendInLoop(const void *message, size_t len);
+  /**
+   * @brief 同上，剩余部分整个Buffer挂到输出缓冲链，不拷贝
+   *
+   * @param message
+   */
+  void sendInLoop(Buffer &&message);
+  /**
+   * @brief 同上，管道中的数据直接splice到socket，剩余部分作为管道段
+   *
+   * @param pipe
+   * @param len
+   */
+  void sendPipeInLoop(const std::shared_ptr<SplicePipe> &pipe, size_t len);
+  /**
+   * @brief 同上，先sendfile一块，剩余部分作为文件段；负责关闭fd
+   *
+   * @param fd sendFile复制的fd
+   * @param offset
+   * @param length
+   */
+  void sendFileInLoop(int fd, off_t offset, size_t length);
+  /**
+   * @brief 输出缓冲链从低于高水位变为不低于高水位时，回调高水位函数
+   *
+   * @param oldLen
+   * @param remaining
+   */
+  void checkHighWaterMark(size_t oldLen, size_t remaining);
+  /**
+   * @brief 超过高水位之后输出缓冲链降到低水位时，回调低水位函数
+   *
+   */
+  void checkLowWaterMark();
+  /**
+   * @brief 文件段写出一块之后，排队回调进度函数
+   *
+   * @param progress total为0时什么也不做
+   */
+  void reportFileProgress(const BufferChain::FileProgress &progress);
   void shutdownInLoop();
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
@@ -87,24 +307,54 @@ private:
   const char *stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  /**
+   * @brief 边沿触发时继续读取，连接已关闭或停止读取时什么也不做
+   *
+   */
+  void resumeRead();
+  /**
+   * @brief BufferPool达到全局上限、输入缓冲无法扩容时暂停读取，
+   * kBufferRetryDelay秒后恢复；与throttleRead共用计数
+   *
+   */
+  void waitForBufferMemory();
+  void setIdleTimeoutInLoop(double seconds);
 
   EventLoop *m_loop;
   const std::string m_name;
   StateE m_state; // FIXME: use atomic variable
   bool m_reading;
-  // we don't expose those classes to client.
-  std::unique_ptr<Socket> m_socket;
-  std::unique_ptr<Channel> m_channel;
+  int m_readThrottles{0}; // throttleRead的计数，只在所属loop中访问
+  // 与连接分配在同一块内存中，不暴露给用户
+  Socket m_socket;
+  Channel m_channel;
   const NetAddress m_localAddr;
   const NetAddress m_peerAddr;
-  ConnectionCallback m_connectionCallback;
-  MessageCallback m_messageCallback;
-  WriteCompleteCallback m_writeCompleteCallback;
-  HighWaterMarkCallback m_highWaterMarkCallback;
-  CloseCallback m_closeCallback;
+  // 回调槽，不分配内存
+  InplaceFunction<void(const TcpConnectionPtr &)> m_connectionCallback;
+  InplaceFunction<void(const TcpConnectionPtr &, Buffer *)> m_messageCallback;
+  InplaceFunction<void(const TcpConnectionPtr &)> m_writeCompleteCallback;
+  InplaceFunction<void(const TcpConnectionPtr &, size_t)>
+      m_highWaterMarkCallback;
+  InplaceFunction<void(const TcpConnectionPtr &)> m_lowWaterMarkCallback;
+  InplaceFunction<void(const TcpConnectionPtr &, size_t, size_t)>
+      m_fileProgressCallback;
+  InplaceFunction<void(const TcpConnectionPtr &)> m_closeCallback;
   size_t m_highWaterMark;
+  size_t m_lowWaterMark{0};
+  bool m_aboveHighWaterMark{false}; // 达到高水位之后还没有降到低水位
+  double m_idleTimeout{0.0};      // 空闲超时秒数，0表示不超时
+  TimingWheel::Entry m_idleEntry; // 挂在m_loop时间轮上的超时项
   Buffer m_inputBuffer;
-  Buffer m_outputBuffer; // FIXME: use list<Buffer> as output buffer.
+  BufferChain m_outputBuffer; // 输出缓冲链，用writev发送
+  std::any m_context;
+  // splice转发的状态
+  size_t m_spliceHeaderLength{0}; // 报头长度，0表示未开启
+  size_t m_spliceRemaining{0};    // 当前报文体还需要转发的字节数
+  TcpConnectionPtr m_spliceDst;   // 当前报文体的目的连接
+  std::shared_ptr<SplicePipe> m_splicePipe;
+  std::weak_ptr<TCPConnection> m_splicePipeDst; // 管道对应的目的连接
+  bool m_splicePaused{false}; // 是否因管道满暂停读取
 };
 using TCPConnectionPtr = std::shared_ptr<TCPConnection>;
 } // namespace neonet
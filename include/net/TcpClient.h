@@ -0,0 +1,106 @@
+/**
+ * @file TcpClient.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief TCP客户端，用Connector建立连接后交给TCPConnection
+ * @version 0.1
+ * @date 2024-08-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TCPCLIENT_H_
+#define TCPCLIENT_H_
+#include "base/Callbacks.h"
+#include "net/Connector.h"
+#include "net/TCPConnection.h"
+#include <mutex>
+#include <string>
+namespace neonet {
+
+class TcpClient {
+public:
+  TcpClient(EventLoop *loop, const NetAddress &serverAddr,
+            const std::string &name);
+  /**
+   * @brief 连接还在时关闭连接，必须在loop还在运行时析构
+   *
+   */
+  ~TcpClient();
+
+  // noncopy
+  TcpClient(const TcpClient &) = delete;
+  TcpClient &operator=(const TcpClient &) = delete;
+
+  /**
+   * @brief 发起连接，线程安全
+   *
+   */
+  void connect();
+  /**
+   * @brief 关闭已经建立的连接(shutdown写端)
+   *
+   */
+  void disconnect();
+  /**
+   * @brief 停止正在进行的连接
+   *
+   */
+  void stop();
+
+  TcpConnectionPtr connection() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connection;
+  }
+  EventLoop *getLoop() const { return m_loop; }
+  const std::string &name() const { return m_name; }
+  bool retry() const { return m_retry; }
+  /**
+   * @brief 连接断开后自动重连
+   *
+   */
+  void enableRetry() { m_retry = true; }
+  /**
+   * @brief 之后建立的连接使用边沿触发
+   *
+   * @param on
+   */
+  void setEdgeTriggered(bool on) { m_edgeTriggered = on; }
+
+  /// Set callbacks, not thread safe, should be called before connect()
+  void setConnectionCallback(const ConnectionCallback &cb) {
+    m_connectionCallback = cb;
+  }
+  void setMessageCallback(const MessageCallback &cb) { m_messageCallback = cb; }
+  void setWriteCompleteCallback(const WriteCompleteCallback &cb) {
+    m_writeCompleteCallback = cb;
+  }
+
+private:
+  /**
+   * @brief Connector的新连接回调，在loop线程中运行
+   *
+   * @param sockfd
+   */
+  void newConnection(int sockfd);
+  /**
+   * @brief 连接的关闭回调，在loop线程中运行
+   *
+   * @param conn
+   */
+  void removeConnection(const TcpConnectionPtr &conn);
+
+  EventLoop *m_loop;
+  ConnectorPtr m_connector;
+  const std::string m_name;
+  ConnectionCallback m_connectionCallback;
+  MessageCallback m_messageCallback;
+  WriteCompleteCallback m_writeCompleteCallback;
+  bool m_retry{false};
+  bool m_connect{true};
+  bool m_edgeTriggered{false};
+  int m_nextConnId{1}; // 只在loop线程中访问
+  mutable std::mutex m_mutex;
+  TcpConnectionPtr m_connection; // 由m_mutex保护
+};
+} // namespace neonet
+#endif // TCPCLIENT_H_
@@ -0,0 +1,166 @@
+/**
+ * @file TcpServer.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief TCP服务器，Acceptor接受连接后分发给EventLoop线程池
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TCPSERVER_H_
+#define TCPSERVER_H_
+#include "base/Callbacks.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/NetAddress.h"
+#include "net/TCPConnection.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+namespace neonet {
+class Acceptor;
+class EventLoop;
+
+class TcpServer {
+public:
+  using ThreadInitCallback = EventLoopThreadPool::ThreadInitCallback;
+
+  /**
+   * @brief 接受连接的方式
+   *
+   * @details
+   * kSingleAcceptor: 只有loop上的一个Acceptor，新连接轮询分配给工作线程；
+   * kReusePort: 每个工作loop各自拥有一个监听同一端口的Acceptor(SO_REUSEPORT)，
+   * 由内核做负载均衡，连接始终在接受它的loop上处理，不跨线程
+   */
+  enum Option { kSingleAcceptor, kReusePort };
+
+  TcpServer(EventLoop *loop, const NetAddress &listenAddr,
+            const std::string &name, Option option = kSingleAcceptor);
+  ~TcpServer();
+
+  // noncopy
+  TcpServer(const TcpServer &) = delete;
+  TcpServer &operator=(const TcpServer &) = delete;
+
+  const std::string &name() const { return m_name; }
+  EventLoop *getLoop() const { return m_loop; }
+
+  /**
+   * @brief 设置处理连接的工作线程数，必须在start之前调用
+   *
+   * @details
+   * 0表示所有I/O都在接受连接的loop上；N表示新连接轮询分配给N个工作线程
+   *
+   * @param numThreads
+   */
+  void setThreadNum(int numThreads);
+  void setThreadInitCallback(const ThreadInitCallback &cb) {
+    m_threadInitCallback = cb;
+  }
+  std::shared_ptr<EventLoopThreadPool> threadPool() { return m_threadPool; }
+
+  /**
+   * @brief 启动线程池并开始监听，可以重复调用，线程安全
+   *
+   */
+  void start();
+
+  void setConnectionCallback(const ConnectionCallback &cb) {
+    m_connectionCallback = cb;
+  }
+  void setMessageCallback(const MessageCallback &cb) { m_messageCallback = cb; }
+  void setWriteCompleteCallback(const WriteCompleteCallback &cb) {
+    m_writeCompleteCallback = cb;
+  }
+  /**
+   * @brief 之后建立的连接在seconds秒内没有收到数据就被关闭，0表示不超时
+   *
+   * @param seconds
+   */
+  void setIdleTimeout(double seconds) { m_idleTimeout = seconds; }
+  /**
+   * @brief 监听套接字和之后建立的连接使用边沿触发，在start之前调用
+   *
+   * @param on
+   */
+  void setEdgeTriggered(bool on) { m_edgeTriggered = on; }
+
+private:
+  using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+
+  /**
+   * @brief 一个loop上的Acceptor和由该loop处理的连接，只在所属的loop中访问；
+   * kSingleAcceptor时Acceptor和连接分属不同的shard
+   *
+   */
+  struct Shard {
+    // 定义在TcpServer.cpp中，那里Acceptor是完整类型
+    Shard(EventLoop *ownerLoop, int shardIndex);
+
+    EventLoop *loop; // Acceptor和连接表所属的EventLoop
+    int index;
+    std::unique_ptr<Acceptor> acceptor; // 只处理连接的shard为空
+    ConnectionMap connections;
+    int nextConnId{1};
+  };
+
+  /**
+   * @brief Acceptor的新连接回调，在shard->loop中运行
+   *
+   * @param shard
+   * @param sockfd
+   * @param peerAddr
+   */
+  void newConnection(Shard *shard, int sockfd, const NetAddress &peerAddr);
+  /**
+   * @brief 在owner->loop中创建连接并加入owner的连接表，
+   * 连接从该loop的slab分配，之后也在该loop中释放
+   *
+   * @param owner
+   * @param sockfd
+   * @param acceptorIndex 接受连接的shard的编号，与connId一起组成连接名
+   * @param connId
+   * @param peerAddr
+   */
+  void createConnection(Shard *owner, int sockfd, int acceptorIndex,
+                        int connId, const NetAddress &peerAddr);
+  /**
+   * @brief 连接关闭回调，线程安全
+   *
+   * @param shard
+   * @param conn
+   */
+  void removeConnection(Shard *shard, const TcpConnectionPtr &conn);
+  void removeConnectionInLoop(Shard *shard, const TcpConnectionPtr &conn);
+  /**
+   * @brief 在shard->loop中关闭Acceptor并销毁所有连接
+   *
+   * @param shard
+   */
+  static void destroyShard(Shard *shard);
+
+private:
+  EventLoop *m_loop; // 创建服务器的EventLoop
+  const NetAddress m_listenAddr;
+  const std::string m_ipPort;
+  const std::string m_name;
+  const Option m_option;
+  std::shared_ptr<EventLoopThreadPool> m_threadPool;
+  ConnectionCallback m_connectionCallback;
+  MessageCallback m_messageCallback;
+  WriteCompleteCallback m_writeCompleteCallback;
+  ThreadInitCallback m_threadInitCallback;
+  double m_idleTimeout{0.0};
+  bool m_edgeTriggered{false};
+  std::atomic<bool> m_started{false};
+  // kSingleAcceptor时一个位于m_loop的Acceptor shard，加上每个工作loop一个
+  // 只处理连接的shard；kReusePort时每个工作loop一个shard，两者兼有
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  std::vector<Shard *> m_connectionShards; // 轮流分配新连接的shard
+  size_t m_nextShard{0};                   // 只在m_loop中访问
+};
+} // namespace neonet
+#endif // TCPSERVER_H_
@@ -0,0 +1,55 @@
+/**
+ * @file Timer.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定时器，保存到期时间、回调和重复间隔
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TIMER_H_
+#define TIMER_H_
+#include "base/Callbacks.h"
+#include "base/Timestamp.h"
+#include <atomic>
+#include <cstdint>
+namespace neonet {
+class Timer {
+public:
+  Timer(TimerCallback cb, Timestamp when, double interval)
+      : m_callback(std::move(cb)), m_expiration(when), m_interval(interval),
+        m_repeat(interval > 0.0), m_sequence(++s_numCreated) {}
+
+  // noncopy
+  Timer(const Timer &) = delete;
+  Timer &operator=(const Timer &) = delete;
+
+  void run() const { m_callback(); }
+
+  Timestamp expiration() const { return m_expiration; }
+  bool repeat() const { return m_repeat; }
+  int64_t sequence() const { return m_sequence; }
+
+  /**
+   * @brief 重复定时器重新计算下一次到期时间
+   *
+   * @param now
+   */
+  void restart(Timestamp now) {
+    m_expiration = m_repeat ? now.addTime(m_interval) : Timestamp::invalid();
+  }
+
+  static int64_t numCreated() { return s_numCreated; }
+
+private:
+  const TimerCallback m_callback; // 到期回调
+  Timestamp m_expiration;         // 到期时间
+  const double m_interval;        // 重复间隔(秒)，0表示只执行一次
+  const bool m_repeat;
+  const int64_t m_sequence; // 全局唯一序号，区分地址相同的定时器
+
+  inline static std::atomic<int64_t> s_numCreated{0};
+};
+} // namespace neonet
+#endif // TIMER_H_
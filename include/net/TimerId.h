@@ -0,0 +1,29 @@
+/**
+ * @file TimerId.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定时器的不透明标识，用于取消定时器
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TIMERID_H_
+#define TIMERID_H_
+#include <cstdint>
+namespace neonet {
+class Timer;
+
+class TimerId {
+public:
+  TimerId() = default;
+  TimerId(Timer *timer, int64_t seq) : m_timer(timer), m_sequence(seq) {}
+
+  friend class TimerQueue;
+
+private:
+  Timer *m_timer{nullptr};
+  int64_t m_sequence{0};
+};
+} // namespace neonet
+#endif // TIMERID_H_
@@ -0,0 +1,102 @@
+/**
+ * @file TimerQueue.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 基于timerfd的定时器队列，到期事件和其他I/O事件一样由epoll分发
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 定时器按(到期时间, Timer*)有序存放在std::set中，插入和取消都是O(log n)；
+ * timerfd始终设置为最早到期的时间。对外接口线程安全，跨线程调用通过
+ * EventLoop::runInLoop转到所属loop中执行
+ *
+ */
+#ifndef TIMERQUEUE_H_
+#define TIMERQUEUE_H_
+#include "base/Callbacks.h"
+#include "base/Timestamp.h"
+#include "net/Channel.h"
+#include "net/TimerId.h"
+#include <set>
+#include <utility>
+#include <vector>
+namespace neonet {
+class EventLoop;
+class Timer;
+
+class TimerQueue {
+public:
+  explicit TimerQueue(EventLoop *loop);
+  ~TimerQueue();
+
+  // noncopy
+  TimerQueue(const TimerQueue &) = delete;
+  TimerQueue &operator=(const TimerQueue &) = delete;
+
+  /**
+   * @brief 添加定时器，在when时刻执行cb，interval>0时重复执行；线程安全
+   *
+   * @param cb
+   * @param when
+   * @param interval
+   * @return TimerId
+   */
+  TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+  /**
+   * @brief 取消定时器；线程安全
+   *
+   * @param timerId
+   */
+  void cancel(TimerId timerId);
+
+private:
+  using Entry = std::pair<Timestamp, Timer *>;
+  using TimerList = std::set<Entry>;
+  using ActiveTimer = std::pair<Timer *, int64_t>;
+  using ActiveTimerSet = std::set<ActiveTimer>;
+
+  void addTimerInLoop(Timer *timer);
+  void cancelInLoop(TimerId timerId);
+  /**
+   * @brief timerfd可读时调用，执行所有到期的定时器
+   *
+   */
+  void handleRead();
+  /**
+   * @brief 取出所有到期的定时器
+   *
+   * @param now
+   * @return std::vector<Entry>
+   */
+  std::vector<Entry> getExpired(Timestamp now);
+  /**
+   * @brief 重复定时器重新插入，其余的释放
+   *
+   * @param expired
+   * @param now
+   */
+  void reset(const std::vector<Entry> &expired, Timestamp now);
+  /**
+   * @brief 插入定时器，返回最早到期时间是否改变
+   *
+   * @param timer
+   * @return true
+   * @return false
+   */
+  bool insert(Timer *timer);
+
+private:
+  EventLoop *m_loop;
+  const int m_timerfd;
+  Channel m_timerfdChannel;
+  TimerList m_timers; // 按到期时间排序
+
+  // 按Timer*排序，用于取消
+  ActiveTimerSet m_activeTimers;
+  bool m_callingExpiredTimers{false};
+  ActiveTimerSet m_cancelingTimers; // 执行到期回调期间被取消的定时器
+};
+} // namespace neonet
+#endif // TIMERQUEUE_H_
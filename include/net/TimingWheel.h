@@ -0,0 +1,154 @@
+/**
+ * @file TimingWheel.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 每个EventLoop一个的分层时间轮，用于大量连接的空闲超时
+ * @version 0.1
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * kLevels层，每层kSlots个槽，每个槽是一个侵入式双向链表；Entry由使用者持有，
+ * 调度、取消都是O(1)的链表操作，不分配内存。延长超时(reschedule)只修改
+ * Entry的deadline，到期时发现deadline未到再重新挂入，所以每条消息刷新一次
+ * 空闲时间只是一次赋值。时间轮由一个TimerQueue中的周期定时器驱动，
+ * 只在有Entry时运行
+ *
+ */
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+#include "base/InplaceFunction.h"
+#include "base/Timestamp.h"
+#include "net/TimerId.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+namespace neonet {
+class EventLoop;
+
+class TimingWheel {
+  struct Node {
+    Node *prev{nullptr};
+    Node *next{nullptr};
+  };
+
+public:
+  /**
+   * @brief 时间轮中的一个定时项，由使用者持有(例如作为TCPConnection的成员)
+   *
+   */
+  class Entry : private Node {
+  public:
+    using Callback = InplaceFunction<void()>;
+    Entry() = default;
+    explicit Entry(Callback cb) : m_callback(std::move(cb)) {}
+    ~Entry() { assert(!linked()); }
+
+    // noncopy
+    Entry(const Entry &) = delete;
+    Entry &operator=(const Entry &) = delete;
+
+    void setCallback(Callback cb) { m_callback = std::move(cb); }
+    bool linked() const { return next != nullptr; }
+
+  private:
+    friend class TimingWheel;
+    uint64_t m_expire{0};   // 所在槽对应的tick
+    uint64_t m_deadline{0}; // 真正的到期tick，m_deadline >= m_expire
+    Callback m_callback;
+  };
+
+  inline static constexpr const double kDefaultTick{0.1}; // 每个tick的秒数
+  inline static constexpr const int kLevelBits{6};
+  inline static constexpr const int kSlots{1 << kLevelBits};
+  inline static constexpr const int kLevels{4};
+  inline static constexpr const uint64_t kMaxTicks{
+      (uint64_t{1} << (kLevelBits * kLevels)) - 1};
+
+  explicit TimingWheel(EventLoop *loop, double tickSeconds = kDefaultTick);
+  ~TimingWheel();
+
+  // noncopy
+  TimingWheel(const TimingWheel &) = delete;
+  TimingWheel &operator=(const TimingWheel &) = delete;
+
+  /**
+   * @brief delay秒后执行entry的回调，entry必须未被调度；只能在loop线程调用
+   *
+   * @param entry
+   * @param delay
+   */
+  void schedule(Entry *entry, double delay);
+  /**
+   * @brief 将entry的到期时间改为delay秒后，未调度时等同于schedule
+   *
+   * @details 延后到期时间只修改deadline，不移动链表节点
+   * @param entry
+   * @param delay
+   */
+  void reschedule(Entry *entry, double delay);
+  /**
+   * @brief 取消entry，未调度时什么也不做
+   *
+   * @param entry
+   */
+  void cancel(Entry *entry);
+
+  size_t size() const { return m_size; }
+  double tickSeconds() const { return m_tickSeconds; }
+
+private:
+  /**
+   * @brief 周期定时器回调，按流逝的时间推进若干个tick
+   *
+   */
+  void onTick();
+  /**
+   * @brief 处理m_current这个tick，并推进m_current
+   *
+   */
+  void advance();
+  /**
+   * @brief 将level层当前槽中的项重新挂到更低的层
+   *
+   * @param level
+   * @return int 该层当前槽的下标
+   */
+  int cascade(int level);
+  /**
+   * @brief 按entry->m_expire挂入对应的层和槽
+   *
+   * @param entry
+   */
+  void link(Entry *entry);
+  static void unlink(Entry *entry);
+  static void pushBack(Node *head, Node *node);
+  /**
+   * @brief 把head链表整体移到out中，head变为空
+   *
+   * @param head
+   * @param out
+   */
+  static void splice(Node *head, Node *out);
+
+  uint64_t toTicks(double delay) const;
+  /**
+   * @brief 按当前时间应该处理到的tick
+   *
+   * @return uint64_t
+   */
+  uint64_t targetTick() const;
+  void startTicking();
+
+private:
+  EventLoop *m_loop;
+  const double m_tickSeconds;
+  const Timestamp m_start; // tick 0对应的时间
+  uint64_t m_current{0};   // 下一个要处理的tick
+  size_t m_size{0};        // 已调度的Entry数
+  bool m_ticking{false};   // 周期定时器是否在运行
+  TimerId m_tickTimer;
+  Node m_wheel[kLevels][kSlots];
+};
+} // namespace neonet
+#endif // TIMINGWHEEL_H_
@@ -0,0 +1,124 @@
+/**
+ * @file FrameDecoder.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 按Header{cmd, length}分帧的解码器，一次读取的所有完整报文一次交给回调
+ * @version 0.1
+ * @date 2024-08-05
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 报头为网络字节序。每次消息回调只扫描一遍输入Buffer，完整的报文以指向
+ * Buffer内部的Frame视图给出，不拷贝；末尾不完整的报文留在Buffer中等待
+ * 下一次读取。回调返回之后解码器才取走这些字节，回调中视图一直有效
+ *
+ */
+#ifndef FRAMEDECODER_H_
+#define FRAMEDECODER_H_
+#include "Config.h"
+#include "base/Callbacks.h"
+#include "protocol/Request.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+namespace neonet {
+class Buffer;
+
+/**
+ * @brief 一个完整报文的视图
+ *
+ */
+struct Frame {
+  uint32_t cmd;     // 主机字节序
+  uint32_t length;  // 报文体字节数
+  const char *data; // 报文体，指向输入Buffer内部
+  /**
+   * @brief 含报头的原始报文
+   *
+   */
+  const char *raw() const { return data - sizeof(Header); }
+  size_t rawSize() const { return sizeof(Header) + length; }
+};
+
+/**
+ * @brief 一次解码得到的所有完整报文，它们在Buffer中是连续的
+ *
+ */
+class FrameBatch {
+public:
+  FrameBatch(const std::vector<Frame> &frames, const char *data, size_t bytes)
+      : m_frames(frames), m_data(data), m_bytes(bytes) {}
+
+  std::vector<Frame>::const_iterator begin() const { return m_frames.begin(); }
+  std::vector<Frame>::const_iterator end() const { return m_frames.end(); }
+  size_t size() const { return m_frames.size(); }
+  const Frame &operator[](size_t i) const { return m_frames[i]; }
+  /**
+   * @brief 所有报文(含报头)的原始字节，可以整体转发
+   *
+   */
+  const char *data() const { return m_data; }
+  size_t bytes() const { return m_bytes; }
+
+private:
+  const std::vector<Frame> &m_frames;
+  const char *m_data;
+  size_t m_bytes;
+};
+
+class FrameDecoder {
+public:
+  using FramesCallback =
+      std::function<void(const TcpConnectionPtr &, const FrameBatch &)>;
+  using ErrorCallback =
+      std::function<void(const TcpConnectionPtr &, uint32_t length)>;
+  inline static constexpr const size_t kHeaderSize{sizeof(Header)};
+  inline static constexpr const uint32_t kDefaultMaxLength{MAXCHARS - 1};
+
+  explicit FrameDecoder(const FramesCallback &cb,
+                        uint32_t maxLength = kDefaultMaxLength);
+
+  /**
+   * @brief 报文体长度超过上限时回调，默认打印并关闭连接
+   *
+   * @param cb
+   */
+  void setErrorCallback(const ErrorCallback &cb) { m_errorCallback = cb; }
+  uint32_t maxLength() const { return m_maxLength; }
+
+  /**
+   * @brief 作为连接的消息回调；可以被多个loop线程同时调用
+   *
+   * @param conn
+   * @param buf
+   */
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf) const;
+
+  /**
+   * @brief 扫描[data, data + len)开头所有完整的报文，追加到frames
+   *
+   * @param data
+   * @param len
+   * @param frames
+   * @param badLength 遇到超过上限的报文时置为其长度，扫描停在它之前
+   * @return size_t 完整报文的总字节数
+   */
+  size_t decode(const char *data, size_t len, std::vector<Frame> *frames,
+                uint32_t *badLength) const;
+
+  /**
+   * @brief 读取报头并转为主机字节序，data至少有kHeaderSize字节
+   *
+   * @param data
+   * @return Header
+   */
+  static Header peekHeader(const char *data);
+
+private:
+  FramesCallback m_framesCallback;
+  ErrorCallback m_errorCallback;
+  const uint32_t m_maxLength;
+};
+} // namespace neonet
+#endif // FRAMEDECODER_H_
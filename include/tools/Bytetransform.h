@@ -8,6 +8,8 @@
  * @copyright Copyright (c) 2024
  *
  */
+#ifndef BYTETRANSFORM_H
+#define BYTETRANSFORM_H
 
 #include <cstdint>
 #include <endian.h>
@@ -24,6 +26,7 @@ inline uint32_t networkToHost32(uint32_t net32) { return be32toh(net32); }
 
 inline uint16_t networkToHost16(uint16_t net16) { return be16toh(net16); }
 } // namespace neonet::socket
+#endif // BYTETRANSFORM_H
 // /**
 //  * @brief 将64位网络字节序转换为主机字节序
 //  *
@@ -0,0 +1,207 @@
+/**
+ * @file AsyncLogging.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 异步日志后端的实现
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "base/AsyncLogging.h"
+#include "base/LogFile.h"
+#include "base/Logging.h"
+#include <chrono>
+#include <cstdio>
+using namespace neonet;
+
+namespace {
+std::atomic<AsyncLogging *> g_asyncLogging{nullptr};
+
+void asyncOutput(const char *msg, size_t len) {
+  AsyncLogging *logging = g_asyncLogging.load(std::memory_order_acquire);
+  if (logging != nullptr) {
+    logging->append(msg, len);
+  } else {
+    ::fwrite(msg, 1, len, stdout);
+  }
+}
+
+void asyncFlush() {
+  AsyncLogging *logging = g_asyncLogging.load(std::memory_order_acquire);
+  if (logging != nullptr) {
+    logging->flush();
+  }
+}
+} // namespace
+
+AsyncLogging::AsyncLogging(const std::string &basename, size_t rollSize,
+                           int flushInterval)
+    : m_basename(basename), m_rollSize(rollSize),
+      m_flushInterval(flushInterval) {}
+
+AsyncLogging::~AsyncLogging() { stop(); }
+
+AsyncLogging::ThreadBuffer *AsyncLogging::threadBuffer() {
+  thread_local ThreadBufferPtr t_buffer;
+  if (!t_buffer || t_buffer->owner != this) {
+    t_buffer = std::make_shared<ThreadBuffer>();
+    t_buffer->current = std::make_unique<Chunk>();
+    t_buffer->owner = this;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadBuffers.push_back(t_buffer);
+  }
+  return t_buffer.get();
+}
+
+void AsyncLogging::append(const char *msg, size_t len) {
+  ThreadBuffer *tb = threadBuffer();
+  std::lock_guard<std::mutex> lock(tb->mutex);
+  if (tb->current->avail() < len) {
+    tb->current = exchangeFull(std::move(tb->current));
+    len = std::min(len, kChunkSize);
+  }
+  tb->current->append(msg, len);
+}
+
+AsyncLogging::ChunkPtr AsyncLogging::exchangeFull(ChunkPtr full) {
+  ChunkPtr next;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fullChunks.push_back(std::move(full));
+    if (!m_freeChunks.empty()) {
+      next = std::move(m_freeChunks.back());
+      m_freeChunks.pop_back();
+    }
+  }
+  m_cond.notify_one();
+  if (!next) {
+    next = std::make_unique<Chunk>();
+  }
+  return next;
+}
+
+void AsyncLogging::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_running) {
+    return;
+  }
+  uint64_t request = ++m_flushRequest;
+  m_cond.notify_one();
+  m_flushedCond.wait_for(lock, std::chrono::seconds(1),
+                         [this, request] { return m_flushed >= request; });
+}
+
+void AsyncLogging::start() {
+  if (m_running.exchange(true)) {
+    return;
+  }
+  m_thread = std::thread([this] { threadFunc(); });
+}
+
+void AsyncLogging::stop() {
+  if (g_asyncLogging.load() == this) {
+    Logger::setOutput(nullptr);
+    Logger::setFlush(nullptr);
+    g_asyncLogging = nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+      return;
+    }
+    m_running = false;
+  }
+  m_cond.notify_one();
+  m_thread.join();
+}
+
+void AsyncLogging::install() {
+  g_asyncLogging.store(this, std::memory_order_release);
+  Logger::setOutput(asyncOutput);
+  Logger::setFlush(asyncFlush);
+}
+
+void AsyncLogging::reapExitedThreads() {
+  for (auto it = m_threadBuffers.begin(); it != m_threadBuffers.end();) {
+    // 线程退出后thread_local的引用已经释放，不会再有人写这个缓冲区
+    if (it->use_count() == 1) {
+      if ((*it)->current->length > 0) {
+        m_fullChunks.push_back(std::move((*it)->current));
+      }
+      it = m_threadBuffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void AsyncLogging::threadFunc() {
+  LogFile output(m_basename, m_rollSize);
+  ChunkVector toWrite;
+  ChunkVector spares; // 用来替换各线程未满的缓冲区
+  std::vector<ThreadBufferPtr> threads;
+  bool running = true;
+  while (running) {
+    uint64_t request;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_fullChunks.empty() && m_flushRequest == m_flushed && m_running) {
+        m_cond.wait_for(lock, std::chrono::seconds(m_flushInterval));
+      }
+      running = m_running;
+      request = m_flushRequest;
+      reapExitedThreads();
+      toWrite.swap(m_fullChunks);
+      threads = m_threadBuffers;
+      while (spares.size() < threads.size() && !m_freeChunks.empty()) {
+        spares.push_back(std::move(m_freeChunks.back()));
+        m_freeChunks.pop_back();
+      }
+    }
+    // 不持有m_mutex，前端拿着自己的锁交出满缓冲区时不会和这里死锁
+    for (const ThreadBufferPtr &tb : threads) {
+      std::lock_guard<std::mutex> lock(tb->mutex);
+      if (tb->current->length == 0) {
+        continue;
+      }
+      ChunkPtr spare;
+      if (spares.empty()) {
+        spare = std::make_unique<Chunk>();
+      } else {
+        spare = std::move(spares.back());
+        spares.pop_back();
+      }
+      std::swap(tb->current, spare);
+      toWrite.push_back(std::move(spare));
+    }
+    threads.clear();
+
+    if (toWrite.size() > kMaxBacklog) {
+      char msg[128];
+      int n = ::snprintf(msg, sizeof(msg),
+                         "Dropped %zu log chunks, logging is too fast\n",
+                         toWrite.size() - 2);
+      ::fputs(msg, stderr);
+      output.append(msg, static_cast<size_t>(n));
+      toWrite.resize(2);
+    }
+    for (const ChunkPtr &chunk : toWrite) {
+      output.append(chunk->data.get(), chunk->length);
+    }
+    output.flush();
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (ChunkPtr &chunk : toWrite) {
+        chunk->length = 0;
+        if (m_freeChunks.size() < kMaxFreeChunks) {
+          m_freeChunks.push_back(std::move(chunk));
+        }
+      }
+      m_flushed = request;
+    }
+    toWrite.clear();
+    m_flushedCond.notify_all();
+  }
+}
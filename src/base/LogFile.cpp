@@ -0,0 +1,85 @@
+/**
+ * @file LogFile.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 滚动日志文件的实现
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "base/LogFile.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+using namespace neonet;
+
+LogFile::LogFile(const std::string &basename, size_t rollSize)
+    : m_basename(basename), m_rollSize(rollSize),
+      m_fileBuffer(new char[kFileBufferSize]) {
+  rollFile(::time(nullptr));
+}
+
+LogFile::~LogFile() {
+  if (m_fp != nullptr) {
+    ::fclose(m_fp);
+  }
+}
+
+void LogFile::append(const char *data, size_t len) {
+  time_t now = ::time(nullptr);
+  if (m_written > m_rollSize ||
+      now / kRollPerSeconds * kRollPerSeconds != m_startOfPeriod) {
+    rollFile(now);
+  }
+  if (m_fp == nullptr) {
+    return;
+  }
+  size_t written = 0;
+  while (written < len) {
+    size_t n = ::fwrite_unlocked(data + written, 1, len - written, m_fp);
+    if (n == 0) {
+      // 磁盘满等错误只能报告到stderr，日志本身丢弃
+      ::fprintf(stderr, "LogFile::append failed: %s\n", ::strerror(errno));
+      break;
+    }
+    written += n;
+  }
+  m_written += written;
+}
+
+void LogFile::flush() {
+  if (m_fp != nullptr) {
+    ::fflush(m_fp);
+  }
+}
+
+void LogFile::rollFile(time_t now) {
+  if (m_fp != nullptr) {
+    ::fclose(m_fp);
+  }
+  std::string filename = getLogFileName(now);
+  m_fp = ::fopen(filename.c_str(), "ae");
+  if (m_fp == nullptr) {
+    ::fprintf(stderr, "LogFile: cannot open %s: %s\n", filename.c_str(),
+              ::strerror(errno));
+  } else {
+    ::setbuffer(m_fp, m_fileBuffer.get(), kFileBufferSize);
+  }
+  m_written = 0;
+  m_startOfPeriod = now / kRollPerSeconds * kRollPerSeconds;
+}
+
+std::string LogFile::getLogFileName(time_t now) const {
+  char timebuf[32];
+  struct tm tm;
+  ::gmtime_r(&now, &tm);
+  ::strftime(timebuf, sizeof(timebuf), ".%Y%m%d-%H%M%S.", &tm);
+  char hostname[256];
+  if (::gethostname(hostname, sizeof(hostname)) != 0) {
+    ::strcpy(hostname, "unknownhost");
+  }
+  hostname[sizeof(hostname) - 1] = '\0';
+  return m_basename + timebuf + hostname + "." + std::to_string(::getpid()) +
+         ".log";
+}
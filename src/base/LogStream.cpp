@@ -0,0 +1,63 @@
+/**
+ * @file LogStream.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 日志流的数值格式化
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "base/LogStream.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+using namespace neonet;
+
+namespace {
+// 最长的整数(含符号)和浮点数的格式化结果
+inline constexpr const size_t kMaxNumericSize{48};
+} // namespace
+
+template <typename T> LogStream &LogStream::formatInteger(T v) {
+  if (avail() >= kMaxNumericSize) {
+    char *end =
+        std::to_chars(m_buffer + m_length, m_buffer + kBufferSize, v).ptr;
+    m_length = static_cast<size_t>(end - m_buffer);
+  }
+  return *this;
+}
+
+LogStream &LogStream::operator<<(int v) { return formatInteger(v); }
+LogStream &LogStream::operator<<(unsigned int v) { return formatInteger(v); }
+LogStream &LogStream::operator<<(long v) { return formatInteger(v); }
+LogStream &LogStream::operator<<(unsigned long v) { return formatInteger(v); }
+LogStream &LogStream::operator<<(long long v) { return formatInteger(v); }
+LogStream &LogStream::operator<<(unsigned long long v) {
+  return formatInteger(v);
+}
+
+LogStream &LogStream::operator<<(double v) {
+  if (avail() >= kMaxNumericSize) {
+    int n = std::snprintf(m_buffer + m_length, kMaxNumericSize, "%.12g", v);
+    m_length += static_cast<size_t>(n);
+  }
+  return *this;
+}
+
+LogStream &LogStream::operator<<(const void *p) {
+  if (avail() >= kMaxNumericSize) {
+    m_buffer[m_length++] = '0';
+    m_buffer[m_length++] = 'x';
+    char *end = std::to_chars(m_buffer + m_length, m_buffer + kBufferSize,
+                              reinterpret_cast<uintptr_t>(p), 16)
+                    .ptr;
+    m_length = static_cast<size_t>(end - m_buffer);
+  }
+  return *this;
+}
+
+LogStream &LogStream::operator<<(std::thread::id id) {
+  return formatInteger(std::hash<std::thread::id>()(id));
+}
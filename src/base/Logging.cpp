@@ -0,0 +1,129 @@
+/**
+ * @file Logging.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 日志前端的实现
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "base/Logging.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+using namespace neonet;
+
+namespace {
+const char *const kLevelNames[Logger::NUM_LOG_LEVELS] = {
+    "TRACE ", "DEBUG ", "INFO  ", "WARN  ", "ERROR ", "FATAL ",
+};
+
+Logger::LogLevel initLogLevel() {
+  const char *env = ::getenv("NEONET_LOG_LEVEL");
+  if (env != nullptr) {
+    for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i) {
+      size_t len = ::strcspn(kLevelNames[i], " ");
+      if (::strncasecmp(env, kLevelNames[i], len) == 0 && env[len] == '\0') {
+        return static_cast<Logger::LogLevel>(i);
+      }
+    }
+  }
+  return Logger::INFO;
+}
+
+void defaultOutput(const char *msg, size_t len) {
+  ::fwrite(msg, 1, len, stdout);
+}
+
+void defaultFlush() { ::fflush(stdout); }
+
+// 可能在其他线程写日志时被替换
+std::atomic<Logger::OutputFunc> g_output{defaultOutput};
+std::atomic<Logger::FlushFunc> g_flush{defaultFlush};
+
+// 每个线程缓存tid和精确到秒的时间字符串，同一秒内只格式化微秒部分
+thread_local char t_tid[16];
+thread_local size_t t_tidLength{0};
+thread_local char t_time[64];
+thread_local time_t t_lastSecond{0};
+thread_local char t_errnoBuf[512];
+
+/**
+ * @brief 去掉__FILE__的目录部分
+ *
+ */
+const char *sourceBasename(const char *file) {
+  const char *slash = ::strrchr(file, '/');
+  return slash != nullptr ? slash + 1 : file;
+}
+} // namespace
+
+Logger::LogLevel neonet::g_logLevel = initLogLevel();
+
+const char *neonet::strerror_tl(int savedErrno) {
+  return ::strerror_r(savedErrno, t_errnoBuf, sizeof(t_errnoBuf));
+}
+
+Logger::Logger(const char *file, int line, LogLevel level, const char *func)
+    : m_level(level), m_file(file), m_line(line) {
+  formatTime();
+  m_stream << kLevelNames[level] << func << ": ";
+}
+
+Logger::Logger(const char *file, int line, bool toAbort)
+    : m_level(toAbort ? FATAL : ERROR), m_file(file), m_line(line) {
+  int savedErrno = errno;
+  formatTime();
+  m_stream << kLevelNames[m_level];
+  if (savedErrno != 0) {
+    m_stream << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") ";
+  }
+}
+
+Logger::~Logger() {
+  m_stream << " - " << sourceBasename(m_file) << ':' << m_line << '\n';
+  g_output.load(std::memory_order_relaxed)(m_stream.data(),
+                                            m_stream.length());
+  if (m_level == FATAL) {
+    g_flush.load()();
+    ::abort();
+  }
+}
+
+void Logger::formatTime() {
+  struct timeval tv;
+  ::gettimeofday(&tv, nullptr);
+  if (tv.tv_sec != t_lastSecond) {
+    t_lastSecond = tv.tv_sec;
+    struct tm tm;
+    ::gmtime_r(&tv.tv_sec, &tm);
+    ::snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
+               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+               tm.tm_min, tm.tm_sec);
+  }
+  if (t_tidLength == 0) {
+    t_tidLength = static_cast<size_t>(
+        ::snprintf(t_tid, sizeof(t_tid), " %5ld ", ::syscall(SYS_gettid)));
+  }
+  char micro[16];
+  int n = ::snprintf(micro, sizeof(micro), ".%06ldZ",
+                     static_cast<long>(tv.tv_usec));
+  m_stream << t_time;
+  m_stream.append(micro, static_cast<size_t>(n));
+  m_stream.append(t_tid, t_tidLength);
+}
+
+void Logger::setLogLevel(LogLevel level) { g_logLevel = level; }
+void Logger::setOutput(OutputFunc out) {
+  g_output = out != nullptr ? out : defaultOutput;
+}
+void Logger::setFlush(FlushFunc flush) {
+  g_flush = flush != nullptr ? flush : defaultFlush;
+}
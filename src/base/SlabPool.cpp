@@ -0,0 +1,133 @@
+/**
+ * @file SlabPool.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief slab池的实现
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "base/SlabPool.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <new>
+using namespace neonet;
+
+SlabPool::SlabPool(size_t blockSize, size_t blocksPerChunk)
+    : m_blockSize((std::max(blockSize, sizeof(FreeBlock)) + kAlignment - 1) /
+                  kAlignment * kAlignment),
+      m_blocksPerChunk(blocksPerChunk > 0 ? blocksPerChunk : 1) {}
+
+SlabPool::~SlabPool() {
+  for (void *chunk : m_chunks) {
+    ::operator delete(chunk, std::align_val_t{kAlignment});
+  }
+}
+
+void *SlabPool::allocate() {
+  void *block = tryAllocate();
+  if (block == nullptr) {
+    grow();
+    block = tryAllocate();
+  }
+  return block;
+}
+
+void *SlabPool::tryAllocate() {
+  assert(isOwnerThread());
+  if (m_localFree == nullptr) {
+    m_localFree = m_remoteFree.exchange(nullptr, std::memory_order_acquire);
+    if (m_localFree == nullptr) {
+      return nullptr;
+    }
+  }
+  FreeBlock *block = m_localFree;
+  m_localFree = block->next;
+  m_inUse.fetch_add(1, std::memory_order_relaxed);
+  return block;
+}
+
+void SlabPool::deallocate(void *p) {
+  FreeBlock *block = static_cast<FreeBlock *>(p);
+  m_inUse.fetch_sub(1, std::memory_order_relaxed);
+  if (isOwnerThread()) {
+    block->next = m_localFree;
+    m_localFree = block;
+    return;
+  }
+  m_remoteFrees.fetch_add(1, std::memory_order_relaxed);
+  FreeBlock *head = m_remoteFree.load(std::memory_order_relaxed);
+  do {
+    block->next = head;
+  } while (!m_remoteFree.compare_exchange_weak(head, block,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+}
+
+size_t SlabPool::trim() {
+  assert(isOwnerThread());
+  FreeBlock *remote = m_remoteFree.exchange(nullptr, std::memory_order_acquire);
+  while (remote != nullptr) {
+    FreeBlock *next = remote->next;
+    remote->next = m_localFree;
+    m_localFree = remote;
+    remote = next;
+  }
+  std::sort(m_chunks.begin(), m_chunks.end(), std::less<void *>());
+  const auto chunkOf = [this](FreeBlock *block) {
+    auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(),
+                               static_cast<void *>(block),
+                               std::less<void *>());
+    return static_cast<size_t>(it - m_chunks.begin()) - 1;
+  };
+  std::vector<size_t> freeBlocks(m_chunks.size(), 0);
+  for (FreeBlock *block = m_localFree; block != nullptr;
+       block = block->next) {
+    ++freeBlocks[chunkOf(block)];
+  }
+  const auto idle = [this, &freeBlocks](size_t chunk) {
+    return freeBlocks[chunk] == m_blocksPerChunk;
+  };
+  size_t released = 0;
+  for (size_t i = 0; i < m_chunks.size(); ++i) {
+    released += idle(i) ? 1 : 0;
+  }
+  if (released == 0) {
+    return 0;
+  }
+  // 从空闲链表中摘掉要归还的chunk中的块，再释放chunk
+  for (FreeBlock **link = &m_localFree; *link != nullptr;) {
+    if (idle(chunkOf(*link))) {
+      *link = (*link)->next;
+    } else {
+      link = &(*link)->next;
+    }
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < m_chunks.size(); ++i) {
+    if (idle(i)) {
+      ::operator delete(m_chunks[i], std::align_val_t{kAlignment});
+    } else {
+      m_chunks[kept++] = m_chunks[i];
+    }
+  }
+  m_chunks.resize(kept);
+  m_capacity.fetch_sub(released * m_blocksPerChunk, std::memory_order_relaxed);
+  return released;
+}
+
+void SlabPool::grow() {
+  char *chunk = static_cast<char *>(::operator new(
+      m_blockSize * m_blocksPerChunk, std::align_val_t{kAlignment}));
+  m_chunks.push_back(chunk);
+  // 倒序串起来，使分配顺序与地址顺序一致
+  for (size_t i = m_blocksPerChunk; i > 0; --i) {
+    FreeBlock *block =
+        reinterpret_cast<FreeBlock *>(chunk + (i - 1) * m_blockSize);
+    block->next = m_localFree;
+    m_localFree = block;
+  }
+  m_capacity.fetch_add(m_blocksPerChunk, std::memory_order_relaxed);
+}
@@ -9,13 +9,13 @@
  *
  */
 #include "net/Acceptor.h"
+#include "base/Logging.h"
 #include "net/EventLoop.h"
 #include "net/NetAddress.h"
 #include "net/Socket.h"
 #include "net/SocketOps.h"
 #include <cassert>
 #include <fcntl.h>
-#include <iostream>
 using namespace neonet;
 
 Acceptor::Acceptor(EventLoop *loop, const NetAddress &listenAddr)
@@ -24,32 +24,11 @@ Acceptor::Acceptor(EventLoop *loop, const NetAddress &listenAddr)
       m_idleFd(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
   assert(m_idleFd >= 0);
   m_acceptSocket.bind(listenAddr);
-
-  /**
-   * @brief acceptchannel的回调函数
-   *
-   */
-  auto acceptconn = [this]() {
-    m_loop->assertInLoopThread();
-    NetAddress peerAddr;
-    int connfd = m_acceptSocket.accept(&peerAddr);
-    if (connfd >= 0) {
-      if (m_newConnectionCallback) {
-        m_newConnectionCallback(connfd, peerAddr);
-      } else {
-        socket::close(connfd);
-      }
-    } else {
-      std::cout << "Acceptor::acceptconn error";
-      if (errno == EMFILE) {
-        ::close(m_idleFd);
-        m_idleFd = ::accept(m_acceptSocket.fd(), nullptr, nullptr);
-        ::close(m_idleFd);
-        m_idleFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-      }
-    }
-  };
-  m_acceptChannel.setReadCallback(acceptconn);
+  m_acceptChannel.setReadCallback([this]() { handleRead(); });
+  // 后端支持时，连接由poller直接接受(multishot accept)
+  if (m_loop->completionIo()) {
+    m_acceptChannel.setCompletionAccept();
+  }
 }
 
 Acceptor::~Acceptor() {
@@ -58,6 +37,85 @@ Acceptor::~Acceptor() {
   ::close(m_idleFd);
 }
 
+void Acceptor::setEdgeTriggered() {
+  assert(!m_listenning);
+  m_acceptChannel.setEdgeTriggered();
+}
+
+void Acceptor::handleRead() {
+  m_loop->assertInLoopThread();
+  if (m_acceptChannel.completionAccept()) {
+    handleAcceptCompletions();
+    return;
+  }
+  if (!m_acceptChannel.isEdgeTriggered()) {
+    acceptOne();
+    return;
+  }
+  // 边沿触发时必须把全连接队列取空，否则不会再收到事件
+  while (acceptOne()) {
+  }
+}
+
+void Acceptor::handleAcceptCompletions() {
+  Channel::Completions *completions = m_acceptChannel.completions();
+  std::vector<int> accepted;
+  accepted.swap(completions->accepted);
+  for (int connfd : accepted) {
+    struct sockaddr peer = socket::getPeerAddr(connfd);
+    NetAddress peerAddr(*socket::sockaddr_in_cast(&peer));
+    if (m_newConnectionCallback) {
+      m_newConnectionCallback(connfd, peerAddr);
+    } else {
+      socket::close(connfd);
+    }
+  }
+  if (completions->error != 0) {
+    int err = completions->error;
+    completions->error = 0;
+    LOG_ERROR << "Acceptor::acceptconn error " << err;
+    if (err == EMFILE) {
+      ::close(m_idleFd);
+      m_idleFd = ::accept(m_acceptSocket.fd(), nullptr, nullptr);
+      ::close(m_idleFd);
+      m_idleFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+  }
+}
+
+bool Acceptor::acceptOne() {
+  NetAddress peerAddr;
+  int connfd = m_acceptSocket.accept(&peerAddr);
+  if (connfd >= 0) {
+    if (m_newConnectionCallback) {
+      m_newConnectionCallback(connfd, peerAddr);
+    } else {
+      socket::close(connfd);
+    }
+    return true;
+  }
+  // 日志可能改写errno，之后的判断都用保存下来的值
+  const int savedErrno = errno;
+  if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+    return false;
+  }
+  LOG_SYSERR << "Acceptor::acceptconn error";
+  if (savedErrno == EMFILE) {
+    // 用预留的fd接受并立即关闭这个连接，不然它会一直留在队列里
+    ::close(m_idleFd);
+    int dropped = ::accept(m_acceptSocket.fd(), nullptr, nullptr);
+    if (dropped >= 0) {
+      ::close(dropped);
+    }
+    m_idleFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    // fd用尽时队列为空也会返回EMFILE，队列取空后就不再继续
+    return dropped >= 0;
+  }
+  // ECONNABORTED等错误只影响这一个连接
+  return savedErrno == ECONNABORTED || savedErrno == EINTR ||
+         savedErrno == EPROTO;
+}
+
 void Acceptor::listen() {
   m_loop->assertInLoopThread();
   m_listenning = true;
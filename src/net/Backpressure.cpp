@@ -0,0 +1,59 @@
+/**
+ * @file Backpressure.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 背压策略的实现
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/Backpressure.h"
+#include "base/Logging.h"
+#include "net/TCPConnection.h"
+#include <cassert>
+using namespace neonet;
+
+Backpressure::Backpressure(size_t highWaterMark, size_t lowWaterMark,
+                           SourceResolver resolver)
+    : m_highWaterMark(highWaterMark), m_lowWaterMark(lowWaterMark),
+      m_resolver(std::move(resolver)) {
+  assert(m_lowWaterMark < m_highWaterMark);
+}
+
+void Backpressure::attach(const TcpConnectionPtr &dst) {
+  std::shared_ptr<Link> link = std::make_shared<Link>(this);
+  dst->setHighWaterMarkCallback(
+      [this, link](const TcpConnectionPtr &conn, size_t) {
+        pause(link.get(), conn);
+      },
+      m_highWaterMark);
+  dst->setLowWaterMarkCallback(
+      [this, link](const TcpConnectionPtr &) { resume(link.get()); },
+      m_lowWaterMark);
+}
+
+void Backpressure::pause(Link *link, const TcpConnectionPtr &dst) {
+  if (!link->pausedSource.expired()) {
+    return;
+  }
+  TcpConnectionPtr source = m_resolver(dst);
+  if (!source || source == dst) {
+    return;
+  }
+  LOG_DEBUG << "Backpressure: " << dst->name() << " has "
+            << dst->outputBuffer()->readableBytes() << " bytes queued, pause "
+            << source->name();
+  link->pausedSource = source;
+  source->throttleRead();
+  m_pauses.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Backpressure::resume(Link *link) {
+  TcpConnectionPtr source = link->pausedSource.lock();
+  link->pausedSource.reset();
+  if (source) {
+    source->unthrottleRead();
+    m_resumes.fetch_add(1, std::memory_order_relaxed);
+  }
+}
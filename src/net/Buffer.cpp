@@ -0,0 +1,269 @@
+/**
+ * @file Buffer.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 缓冲区的实现
+ * @version 0.1
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/Buffer.h"
+#include "base/Logging.h"
+#include "net/SocketOps.h"
+#include <algorithm>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+using namespace neonet;
+
+namespace {
+/**
+ * @brief 把同一个memfd的size字节连续映射两次
+ *
+ * @param size 页大小的整数倍
+ * @return char* 失败时返回nullptr
+ */
+char *mapMirrored(size_t size) {
+  int fd = ::memfd_create("neonet-buffer", MFD_CLOEXEC);
+  if (fd < 0) {
+    LOG_SYSERR << "Buffer: memfd_create";
+    return nullptr;
+  }
+  char *base = nullptr;
+  if (::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+    LOG_SYSERR << "Buffer: ftruncate";
+  } else {
+    // 先占住两倍的地址空间，再把memfd固定映射到前后两半
+    void *area = ::mmap(nullptr, 2 * size, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+      LOG_SYSERR << "Buffer: mmap";
+    } else {
+      base = static_cast<char *>(area);
+      for (char *half : {base, base + size}) {
+        if (::mmap(half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                   fd, 0) == MAP_FAILED) {
+          LOG_SYSERR << "Buffer: mmap mirror";
+          ::munmap(base, 2 * size);
+          base = nullptr;
+          break;
+        }
+      }
+    }
+  }
+  ::close(fd);
+  return base;
+}
+
+size_t roundUpToPage(size_t size) {
+  static const size_t kPageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  return (std::max<size_t>(size, 1) + kPageSize - 1) / kPageSize * kPageSize;
+}
+} // namespace
+
+Buffer::Buffer(const Buffer &other)
+    : m_storage{nullptr, 0, false}, m_pool(other.m_pool), m_readerIndex(0),
+      m_writerIndex(0) {
+  if (other.mirrored() && remapMirrored(other.internalCapacity())) {
+    append(other.peek(), other.readableBytes());
+  } else if (!m_pool || other.readableBytes() > 0) {
+    reallocate(kCheapPrepend + other.readableBytes());
+    append(other.peek(), other.readableBytes());
+  }
+}
+
+Buffer &Buffer::operator=(const Buffer &other) {
+  if (this != &other) {
+    Buffer copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+Buffer::Buffer(Buffer &&other) noexcept
+    : m_storage(other.m_storage), m_pool(other.m_pool),
+      m_readerIndex(other.m_readerIndex), m_writerIndex(other.m_writerIndex) {
+  other.m_storage = Storage{nullptr, 0, false};
+  other.m_readerIndex = 0;
+  other.m_writerIndex = 0;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+  if (this != &other) {
+    releaseStorage();
+    m_storage = other.m_storage;
+    m_pool = other.m_pool;
+    m_readerIndex = other.m_readerIndex;
+    m_writerIndex = other.m_writerIndex;
+    other.m_storage = Storage{nullptr, 0, false};
+    other.m_readerIndex = 0;
+    other.m_writerIndex = 0;
+  }
+  return *this;
+}
+
+bool Buffer::makeMirrored(size_t capacity) {
+  if (mirrored()) {
+    return true;
+  }
+  if (!remapMirrored(std::max(capacity, readableBytes()))) {
+    return false;
+  }
+  m_pool.reset();
+  return true;
+}
+
+void Buffer::shrink(size_t reserve) {
+  if (mirrored()) {
+    remapMirrored(readableBytes() + reserve);
+    return;
+  }
+  if (m_pool && readableBytes() == 0) {
+    releaseStorage();
+    return;
+  }
+  reallocate(kCheapPrepend + readableBytes() + reserve);
+}
+
+void Buffer::grow(size_t len) {
+  if (mirrored()) {
+    // 映射失败时退回线性存储
+    size_t size = std::max(readableBytes() + len, m_storage.size * 2);
+    if (!remapMirrored(size)) {
+      reallocate(kCheapPrepend + readableBytes() + len);
+    }
+    return;
+  }
+  // 堆上的存储按倍数增长；池中的块由池向上取整到所在级别
+  size_t size = kCheapPrepend + readableBytes() + len;
+  reallocate(std::max(size, m_storage.size * 2));
+}
+
+void Buffer::reallocate(size_t size) {
+  assert(size >= kCheapPrepend + readableBytes());
+  if (m_pool) {
+    adoptBlock(m_pool->acquire(size));
+  } else {
+    adoptBlock(BufferPool::Block{new char[size], size});
+  }
+}
+
+bool Buffer::tryReallocate(size_t size) {
+  assert(m_pool && size >= kCheapPrepend + readableBytes());
+  BufferPool::Block block = m_pool->tryAcquire(size);
+  if (block.data == nullptr) {
+    return false;
+  }
+  adoptBlock(block);
+  return true;
+}
+
+void Buffer::adoptBlock(const BufferPool::Block &block) {
+  const size_t readable = readableBytes();
+  if (readable > 0) {
+    ::memcpy(block.data + kCheapPrepend, peek(), readable);
+  }
+  releaseStorage();
+  m_storage = Storage{block.data, block.size, false};
+  m_readerIndex = kCheapPrepend;
+  m_writerIndex = kCheapPrepend + readable;
+}
+
+bool Buffer::remapMirrored(size_t size) {
+  const size_t readable = readableBytes();
+  size = roundUpToPage(size);
+  assert(size >= readable);
+  char *base = mapMirrored(size);
+  if (base == nullptr) {
+    return false;
+  }
+  if (readable > 0) {
+    ::memcpy(base, peek(), readable);
+  }
+  releaseStorage();
+  m_storage = Storage{base, size, true};
+  m_readerIndex = 0;
+  m_writerIndex = readable;
+  return true;
+}
+
+void Buffer::releaseStorage() {
+  if (m_storage.mirrored) {
+    ::munmap(m_storage.data, 2 * m_storage.size);
+  } else if (m_storage.data != nullptr) {
+    if (m_pool) {
+      m_pool->release(BufferPool::Block{m_storage.data, m_storage.size});
+    } else {
+      delete[] m_storage.data;
+    }
+  }
+  m_storage = Storage{nullptr, 0, false};
+  m_readerIndex = 0;
+  m_writerIndex = 0;
+}
+
+ssize_t Buffer::readFd(int fd, int *savedErrno) {
+  if (mirrored()) {
+    if (writableBytes() == 0) {
+      grow(m_storage.size);
+    }
+    if (mirrored()) {
+      const ssize_t n = socket::read(fd, beginWrite(), writableBytes());
+      if (n < 0) {
+        *savedErrno = errno;
+      } else {
+        m_writerIndex += n;
+      }
+      return n;
+    }
+  }
+  // 栈上的额外缓冲区，避免为最坏情况预先分配空间
+  char extrabuf[65536];
+  constexpr size_t kLargestBlock = BufferPool::kClassSizes[
+      BufferPool::kClassCount - 1];
+  if (m_pool && m_storage.data == nullptr) {
+    // 空的池化Buffer先借一个最小的块，小消息直接读进块中
+    if (!tryReallocate(BufferPool::kClassSizes[0])) {
+      *savedErrno = ENOBUFS;
+      return -1;
+    }
+  }
+  // 超过全局上限时只用池中已有的块扩容，不申请新内存，也不用extrabuf
+  const bool capped = m_pool && BufferPool::overLimit();
+  if (capped && writableBytes() == 0) {
+    if (prependableBytes() > kCheapPrepend) {
+      makeSpace(prependableBytes() - kCheapPrepend);
+    } else if (!tryReallocate(m_storage.size + 1)) {
+      *savedErrno = ENOBUFS;
+      return -1;
+    }
+  }
+  struct iovec vec[2];
+  const size_t writable = writableBytes();
+  vec[0].iov_base = begin() + m_writerIndex;
+  vec[0].iov_len = writable;
+  vec[1].iov_base = extrabuf;
+  vec[1].iov_len = sizeof extrabuf;
+  const size_t used = kCheapPrepend + readableBytes() + writable;
+  if (m_pool && m_storage.size < kLargestBlock && used < kLargestBlock) {
+    // 一次读取的总量不超过最大的块，扩容时仍然能从池中借用
+    vec[1].iov_len = std::min(sizeof extrabuf, kLargestBlock - used);
+  }
+  // 可写空间已经足够大时，不再使用extrabuf
+  const int iovcnt = (!capped && writable < sizeof extrabuf) ? 2 : 1;
+  const ssize_t n = socket::readv(fd, vec, iovcnt);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else if (static_cast<size_t>(n) <= writable) {
+    m_writerIndex += n;
+  } else {
+    m_writerIndex = m_storage.size;
+    append(extrabuf, n - writable);
+  }
+  if (m_pool && readableBytes() == 0) {
+    releaseStorage();
+  }
+  return n;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file BufferChain.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 输出缓冲链的实现
+ * @version 0.1
+ * @date 2024-07-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/BufferChain.h"
+#include "net/SocketOps.h"
+#include "net/SplicePipe.h"
+#include <algorithm>
+#include <climits>
+#include <errno.h>
+#include <sys/uio.h>
+using namespace neonet;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+BufferChain::~BufferChain() {
+  // 管道段的字节必须取走，否则同一管道中后面的数据无法送达
+  retrieveAll();
+}
+
+void BufferChain::append(const void *data, size_t len) {
+  const char *d = static_cast<const char *>(data);
+  if (!m_segments.empty() && m_segments.back().inMemory()) {
+    // 先填满尾段的空闲空间，不触发尾段的扩容整理
+    // 空的尾段(如已归还存储的池化段)整体写入，按需借用存储
+    Buffer &tail = m_segments.back().buffer;
+    size_t n =
+        tail.readableBytes() == 0 ? len : std::min(len, tail.writableBytes());
+    tail.append(d, n);
+    d += n;
+    len -= n;
+    m_readableBytes += n;
+  }
+  if (len > 0) {
+    if (m_pool) {
+      m_segments.emplace_back(Buffer(m_pool));
+    } else {
+      m_segments.emplace_back(Buffer(std::max(len, kSegmentSize)));
+    }
+    m_segments.back().buffer.append(d, len);
+    m_readableBytes += len;
+  }
+}
+
+void BufferChain::append(Buffer &&buf) {
+  if (buf.readableBytes() == 0) {
+    return;
+  }
+  m_readableBytes += buf.readableBytes();
+  m_segments.emplace_back(std::move(buf));
+}
+
+void BufferChain::appendPipe(const std::shared_ptr<SplicePipe> &pipe,
+                             size_t len) {
+  if (len == 0) {
+    return;
+  }
+  m_readableBytes += len;
+  if (!m_segments.empty() && m_segments.back().pipe == pipe) {
+    m_segments.back().pipeBytes += len;
+    return;
+  }
+  m_segments.emplace_back();
+  m_segments.back().pipe = pipe;
+  m_segments.back().pipeBytes = len;
+}
+
+void BufferChain::appendFile(int fd, off_t offset, size_t len,
+                             size_t regionLength) {
+  if (len == 0) {
+    socket::close(fd);
+    return;
+  }
+  m_readableBytes += len;
+  m_segments.emplace_back();
+  m_segments.back().file = fd;
+  m_segments.back().fileOffset = offset;
+  m_segments.back().fileBytes = len;
+  m_segments.back().fileLength = std::max(len, regionLength);
+}
+
+void BufferChain::popFront() {
+  if (m_segments.front().file >= 0) {
+    socket::close(m_segments.front().file);
+  }
+  m_segments.pop_front();
+}
+
+void BufferChain::retrieve(size_t len) {
+  assert(len <= m_readableBytes);
+  m_readableBytes -= len;
+  while (len > 0) {
+    Segment &front = m_segments.front();
+    size_t n = std::min(len, front.readableBytes());
+    if (front.pipe) {
+      front.pipe->discard(n);
+      front.pipeBytes -= n;
+    } else if (front.file >= 0) {
+      front.fileOffset += static_cast<off_t>(n);
+      front.fileBytes -= n;
+    } else {
+      front.buffer.retrieve(n);
+    }
+    len -= n;
+    if (front.readableBytes() == 0) {
+      // 最后一个内存段保留下来复用，避免下次发送重新分配
+      if (m_segments.size() == 1 && front.inMemory() &&
+          front.buffer.internalCapacity() <=
+              Buffer::kCheapPrepend + kSegmentSize) {
+        break;
+      }
+      popFront();
+    }
+  }
+}
+
+void BufferChain::retrieveAll() {
+  for (Segment &seg : m_segments) {
+    if (seg.pipe && seg.pipeBytes > 0) {
+      seg.pipe->discard(seg.pipeBytes);
+    }
+    if (seg.file >= 0) {
+      socket::close(seg.file);
+    }
+  }
+  m_segments.clear();
+  m_readableBytes = 0;
+}
+
+ssize_t BufferChain::writeFd(int fd, int *savedErrno,
+                             FileProgress *progress) {
+  if (progress != nullptr) {
+    *progress = FileProgress();
+  }
+  // 保留复用的空内存段后面可能追加了管道段或文件段
+  while (m_segments.size() > 1 && m_segments.front().readableBytes() == 0) {
+    popFront();
+  }
+  if (!m_segments.empty() && m_segments.front().pipe) {
+    Segment &front = m_segments.front();
+    ssize_t n = front.pipe->spliceTo(fd, front.pipeBytes, savedErrno);
+    if (n > 0) {
+      front.pipeBytes -= static_cast<size_t>(n);
+      m_readableBytes -= static_cast<size_t>(n);
+      if (front.pipeBytes == 0) {
+        popFront();
+      }
+    }
+    return n;
+  }
+  if (!m_segments.empty() && m_segments.front().file >= 0) {
+    return sendFileSegment(fd, savedErrno, progress);
+  }
+  // 只收集管道段和文件段之前的内存段，保证字节顺序
+  struct iovec vec[IOV_MAX];
+  int iovcnt = 0;
+  for (Segment &seg : m_segments) {
+    if (iovcnt == IOV_MAX || !seg.inMemory()) {
+      break;
+    }
+    if (seg.buffer.readableBytes() == 0) {
+      continue;
+    }
+    vec[iovcnt].iov_base = const_cast<char *>(seg.buffer.peek());
+    vec[iovcnt].iov_len = seg.buffer.readableBytes();
+    ++iovcnt;
+  }
+  if (iovcnt == 0) {
+    return 0;
+  }
+  ssize_t n = socket::writev(fd, vec, iovcnt);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else {
+    retrieve(static_cast<size_t>(n));
+  }
+  return n;
+}
+
+ssize_t BufferChain::sendFileSegment(int fd, int *savedErrno,
+                                     FileProgress *progress) {
+  Segment &front = m_segments.front();
+  off_t offset = front.fileOffset;
+  ssize_t n = socket::sendfile(fd, front.file, &offset,
+                               std::min(front.fileBytes, kFileChunkSize));
+  if (n < 0) {
+    *savedErrno = errno;
+    return n;
+  }
+  if (n == 0) {
+    // 文件在发送前被截断，剩下的字节永远无法送达
+    *savedErrno = EIO;
+    return -1;
+  }
+  front.fileOffset = offset;
+  front.fileBytes -= static_cast<size_t>(n);
+  m_readableBytes -= static_cast<size_t>(n);
+  if (progress != nullptr) {
+    progress->sent = front.fileLength - front.fileBytes;
+    progress->total = front.fileLength;
+  }
+  if (front.fileBytes == 0) {
+    popFront();
+  }
+  return n;
+}
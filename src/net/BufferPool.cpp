@@ -0,0 +1,194 @@
+/**
+ * @file BufferPool.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 缓冲区内存块池的实现
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/BufferPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+using namespace neonet;
+
+namespace {
+std::atomic<size_t> g_totalBytes{0}; // 所有池的chunk和堆上的块的字节数
+std::atomic<size_t> g_memoryLimit{0};
+
+/**
+ * @brief 再申请bytes字节之后总字节数是否仍不超过全局上限
+ *
+ */
+bool withinLimit(size_t bytes) {
+  size_t limit = g_memoryLimit.load(std::memory_order_relaxed);
+  return limit == 0 ||
+         g_totalBytes.load(std::memory_order_relaxed) + bytes <= limit;
+}
+} // namespace
+
+std::string BufferPool::Stats::toString() const {
+  char buf[192];
+  ::snprintf(buf, sizeof buf,
+             "pooled %zuKB, in use %zuKB, heap %zuKB, trimmed %zuKB, "
+             "heap blocks %llu, limit hits %llu",
+             pooledBytes / 1024, inUseBytes / 1024, heapBytes / 1024,
+             trimmedBytes / 1024,
+             static_cast<unsigned long long>(heapBlocks),
+             static_cast<unsigned long long>(limitHits));
+  return buf;
+}
+
+BufferPool::BufferPool()
+    : m_slabs{SlabPool(kClassSizes[0], kChunkBytes / kClassSizes[0]),
+              SlabPool(kClassSizes[1], kChunkBytes / kClassSizes[1]),
+              SlabPool(kClassSizes[2], kChunkBytes / kClassSizes[2])} {
+  for (size_t i = 0; i < kClassCount; ++i) {
+    m_trimAt[i] = kIdleChunks * m_slabs[i].blocksPerChunk() + 1;
+  }
+}
+
+BufferPool::~BufferPool() {
+  g_totalBytes.fetch_sub(stats().pooledBytes, std::memory_order_relaxed);
+}
+
+BufferPool::Block BufferPool::acquire(size_t minSize) {
+  Block block = tryAcquire(minSize);
+  if (block.data == nullptr) {
+    // 数据必须保存下来，超出上限也要分配
+    block = allocateHeap(minSize);
+  }
+  return block;
+}
+
+BufferPool::Block BufferPool::tryAcquire(size_t minSize) {
+  if (m_slabs[0].isOwnerThread()) {
+    for (size_t i = 0; i < kClassCount; ++i) {
+      if (kClassSizes[i] < minSize) {
+        continue;
+      }
+      void *data = acquireFromClass(i);
+      if (data == nullptr) {
+        m_limitHits.fetch_add(1, std::memory_order_relaxed);
+        return Block{};
+      }
+      return Block{static_cast<char *>(data), kClassSizes[i]};
+    }
+  }
+  if (!withinLimit(minSize)) {
+    m_limitHits.fetch_add(1, std::memory_order_relaxed);
+    return Block{};
+  }
+  return allocateHeap(minSize);
+}
+
+void *BufferPool::acquireFromClass(size_t index) {
+  SlabPool &slab = m_slabs[index];
+  void *data = slab.tryAllocate();
+  if (data == nullptr) {
+    const size_t chunkBytes = slab.blockSize() * slab.blocksPerChunk();
+    // 达到上限时先回收本池的空闲chunk
+    if (!withinLimit(chunkBytes) && (trim() == 0 || !withinLimit(chunkBytes))) {
+      return nullptr;
+    }
+    g_totalBytes.fetch_add(chunkBytes, std::memory_order_relaxed);
+    data = slab.allocate();
+  }
+  // 空闲块减少时跟着降低回收的门槛
+  const size_t trimAt = slab.capacity() - slab.inUse() +
+                        kIdleChunks * slab.blocksPerChunk() + 1;
+  m_trimAt[index] = std::min(m_trimAt[index], trimAt);
+  return data;
+}
+
+BufferPool::Block BufferPool::allocateHeap(size_t minSize) {
+  m_heapBlocks.fetch_add(1, std::memory_order_relaxed);
+  Block block{nullptr, minSize};
+  if (isPooled(block)) {
+    block.size += SlabPool::kAlignment; // 与池中的块区分开
+  }
+  block.data = new char[block.size];
+  m_heapBytes.fetch_add(block.size, std::memory_order_relaxed);
+  g_totalBytes.fetch_add(block.size, std::memory_order_relaxed);
+  return block;
+}
+
+void BufferPool::release(const Block &block) {
+  if (!isPooled(block)) {
+    delete[] block.data;
+    m_heapBytes.fetch_sub(block.size, std::memory_order_relaxed);
+    g_totalBytes.fetch_sub(block.size, std::memory_order_relaxed);
+    return;
+  }
+  for (size_t i = 0; i < kClassCount; ++i) {
+    if (kClassSizes[i] == block.size) {
+      m_slabs[i].deallocate(block.data);
+      if (m_slabs[i].isOwnerThread()) {
+        trimIdle(i);
+      }
+      return;
+    }
+  }
+  assert(false);
+}
+
+size_t BufferPool::trim() {
+  size_t bytes = 0;
+  for (size_t i = 0; i < kClassCount; ++i) {
+    bytes += chunksTrimmed(i, m_slabs[i].trim());
+  }
+  return bytes;
+}
+
+void BufferPool::trimIdle(size_t index) {
+  SlabPool &slab = m_slabs[index];
+  const size_t idle = slab.capacity() - slab.inUse();
+  // 超过全局上限时只要可能空出一个chunk就回收，让其他loop能够申请
+  if (idle < m_trimAt[index] &&
+      (idle < slab.blocksPerChunk() || !overLimit())) {
+    return;
+  }
+  chunksTrimmed(index, slab.trim());
+}
+
+size_t BufferPool::chunksTrimmed(size_t index, size_t chunks) {
+  SlabPool &slab = m_slabs[index];
+  // 剩下的空闲块分散在仍在使用的chunk中，再空出kIdleChunks个chunk才回收
+  m_trimAt[index] = slab.capacity() - slab.inUse() +
+                    kIdleChunks * slab.blocksPerChunk() + 1;
+  const size_t bytes = chunks * slab.blockSize() * slab.blocksPerChunk();
+  if (bytes > 0) {
+    g_totalBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    m_trimmedBytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  return bytes;
+}
+
+BufferPool::Stats BufferPool::stats() const {
+  Stats stats;
+  for (const SlabPool &slab : m_slabs) {
+    stats.pooledBytes += slab.capacity() * slab.blockSize();
+    stats.inUseBytes += slab.inUse() * slab.blockSize();
+  }
+  stats.heapBytes = m_heapBytes.load(std::memory_order_relaxed);
+  stats.trimmedBytes = m_trimmedBytes.load(std::memory_order_relaxed);
+  stats.heapBlocks = m_heapBlocks.load(std::memory_order_relaxed);
+  stats.limitHits = m_limitHits.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void BufferPool::setMemoryLimit(size_t bytes) {
+  g_memoryLimit.store(bytes, std::memory_order_relaxed);
+}
+
+size_t BufferPool::memoryLimit() {
+  return g_memoryLimit.load(std::memory_order_relaxed);
+}
+
+size_t BufferPool::totalPooledBytes() {
+  return g_totalBytes.load(std::memory_order_relaxed);
+}
+
+bool BufferPool::overLimit() { return !withinLimit(1); }
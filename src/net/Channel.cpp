@@ -10,9 +10,9 @@
  */
 
 #include "net/Channel.h"
+#include "base/Logging.h"
 #include "net/EventLoop.h"
 #include <cassert>
-#include <iostream>
 #include <string>
 using namespace neonet;
 
@@ -31,7 +31,33 @@ void Channel::tie(const std::shared_ptr<void> &obj) {
   m_isTied = true;
 }
 
+int Channel::pollEvents() const {
+  if (!m_edgeTriggered) {
+    return m_events;
+  }
+  if (!m_armed) {
+    return kNoneEvent;
+  }
+  return kEdgeEvents;
+}
+
+void Channel::setCompletionRecv(Buffer *buffer) {
+  m_recvBuffer = buffer;
+  // 已经注册时需要提交或取消接收请求
+  if (m_addedToLoop) {
+    m_loop->updateChannel(this);
+  }
+}
+
 void Channel::update() {
+  int events = pollEvents();
+  // 边沿触发时注册的事件是固定的，只有注册和注销才需要epoll_ctl；
+  // 完成模式需要知道读事件的开关，以便取消和重新提交接收请求
+  if (m_edgeTriggered && !completionMode() && m_addedToLoop &&
+      events == m_registeredEvents) {
+    return;
+  }
+  m_registeredEvents = events;
   m_addedToLoop = true;
   m_loop->updateChannel(this);
 }
@@ -39,6 +65,7 @@ void Channel::update() {
 void Channel::remove() {
   assert(isNoneEvent());
   m_addedToLoop = false;
+  m_registeredEvents = kNoneEvent;
   m_loop->removeChannel(this);
 }
 
@@ -56,7 +83,7 @@ void Channel::handleEvent() {
 
 void Channel::handleEventWithGuard() {
   m_eventHandling = true;
-  std::cout << reventsToString();
+  LOG_TRACE << reventsToString();
   if ((m_revents & EPOLLHUP) && !(m_revents & EPOLLIN)) {
     if (m_closeCallback)
       m_closeCallback();
@@ -65,11 +92,14 @@ void Channel::handleEventWithGuard() {
     if (m_errorCallback)
       m_errorCallback();
   }
-  if (m_revents & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
+  // 边沿触发时epoll总是报告读写事件，只分发当前关注的
+  const bool wantRead = !m_edgeTriggered || isReading();
+  const bool wantWrite = !m_edgeTriggered || isWriting();
+  if ((m_revents & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) && wantRead) {
     if (m_readCallback)
       m_readCallback();
   }
-  if (m_revents & EPOLLOUT) {
+  if ((m_revents & EPOLLOUT) && wantWrite) {
     if (m_writeCallback)
       m_writeCallback();
   }
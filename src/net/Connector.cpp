@@ -0,0 +1,157 @@
+/**
+ * @file Connector.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 非阻塞连接的实现
+ * @version 0.1
+ * @date 2024-08-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/Connector.h"
+#include "base/Logging.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/SocketOps.h"
+#include <algorithm>
+#include <cassert>
+#include <errno.h>
+using namespace neonet;
+
+Connector::Connector(EventLoop *loop, const NetAddress &serverAddr)
+    : m_loop(loop), m_serverAddr(serverAddr) {}
+
+Connector::~Connector() { assert(!m_channel); }
+
+void Connector::start() {
+  m_connect = true;
+  auto self = shared_from_this();
+  m_loop->runInLoop([self]() { self->startInLoop(); });
+}
+
+void Connector::startInLoop() {
+  m_loop->assertInLoopThread();
+  assert(m_state == kDisconnected);
+  if (m_connect) {
+    connect();
+  }
+}
+
+void Connector::stop() {
+  m_connect = false;
+  auto self = shared_from_this();
+  m_loop->queueInLoop([self]() { self->stopInLoop(); });
+}
+
+void Connector::stopInLoop() {
+  m_loop->assertInLoopThread();
+  m_loop->cancel(m_retryTimer);
+  if (m_state == kConnecting) {
+    setState(kDisconnected);
+    int sockfd = removeAndResetChannel();
+    retry(sockfd);
+  }
+}
+
+void Connector::restart() {
+  m_loop->assertInLoopThread();
+  setState(kDisconnected);
+  m_retryDelay = kInitRetryDelay;
+  m_connect = true;
+  startInLoop();
+}
+
+void Connector::connect() {
+  int sockfd = socket::createNonblocking();
+  int ret = socket::connect(sockfd, socket::sockaddr_cast(
+                                        &m_serverAddr.getAddr()));
+  int savedErrno = (ret == 0) ? 0 : errno;
+  switch (savedErrno) {
+  case 0:
+  case EINPROGRESS:
+  case EINTR:
+  case EISCONN:
+    connecting(sockfd);
+    break;
+
+  case EAGAIN:
+  case EADDRINUSE:
+  case EADDRNOTAVAIL:
+  case ECONNREFUSED:
+  case ENETUNREACH:
+    retry(sockfd);
+    break;
+
+  default:
+    LOG_ERROR << "Connector::connect error " << strerror_tl(savedErrno);
+    socket::close(sockfd);
+    break;
+  }
+}
+
+void Connector::connecting(int sockfd) {
+  setState(kConnecting);
+  assert(!m_channel);
+  m_channel.reset(new Channel(m_loop, sockfd));
+  m_channel->setWriteCallback([this]() { handleWrite(); });
+  m_channel->setErrorCallback([this]() { handleError(); });
+  m_channel->enableWriting();
+}
+
+int Connector::removeAndResetChannel() {
+  m_channel->disableAll();
+  m_channel->remove();
+  int sockfd = m_channel->fd();
+  // 可能还在Channel::handleEvent中，不能在这里释放Channel
+  auto self = shared_from_this();
+  m_loop->queueInLoop([self]() { self->m_channel.reset(); });
+  return sockfd;
+}
+
+void Connector::handleWrite() {
+  if (m_state != kConnecting) {
+    assert(m_state == kDisconnected);
+    return;
+  }
+  int sockfd = removeAndResetChannel();
+  int err = socket::getSocketError(sockfd);
+  if (err != 0) {
+    LOG_WARN << "Connector::handleWrite - SO_ERROR = " << err << " "
+             << strerror_tl(err);
+    retry(sockfd);
+  } else if (socket::isSelfConnect(sockfd)) {
+    LOG_WARN << "Connector::handleWrite - Self connect";
+    retry(sockfd);
+  } else {
+    setState(kConnected);
+    if (m_connect && m_newConnectionCallback) {
+      m_newConnectionCallback(sockfd);
+    } else {
+      socket::close(sockfd);
+    }
+  }
+}
+
+void Connector::handleError() {
+  if (m_state == kConnecting) {
+    int sockfd = removeAndResetChannel();
+    int err = socket::getSocketError(sockfd);
+    LOG_TRACE << "Connector::handleError - SO_ERROR = " << err << " "
+              << strerror_tl(err);
+    retry(sockfd);
+  }
+}
+
+void Connector::retry(int sockfd) {
+  socket::close(sockfd);
+  setState(kDisconnected);
+  if (m_connect) {
+    std::weak_ptr<Connector> weakSelf(shared_from_this());
+    m_retryTimer = m_loop->runAfter(m_retryDelay, [weakSelf]() {
+      if (ConnectorPtr self = weakSelf.lock()) {
+        self->startInLoop();
+      }
+    });
+    m_retryDelay = std::min(m_retryDelay * 2, kMaxRetryDelay);
+  }
+}
@@ -9,11 +9,12 @@
  *
  */
 #include "net/EPoller.h"
+#include "base/Logging.h"
 #include "net/Channel.h"
 #include "net/EventLoop.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <iostream>
 #include <unistd.h>
 using namespace neonet;
 
@@ -23,32 +24,33 @@ const int kAdded = 1;
 const int kDeleted = 2;
 } // namespace
 EPoller::EPoller(EventLoop *loop)
-    : m_ownerLoop(loop), m_epollFd(::epoll_create1(EPOLL_CLOEXEC)),
-      m_events(kInitEventListSize) {
+    : Poller(loop), m_channels(kInitChannelTableSize),
+      m_epollFd(::epoll_create1(EPOLL_CLOEXEC)), m_events(kInitEventListSize) {
   if (m_epollFd < 0) {
-    std::cout << "Failed in epoll_create1";
+    LOG_SYSFATAL << "Failed in epoll_create1";
   }
 }
 
 EPoller::~EPoller() { ::close(m_epollFd); }
 
-void EPoller::epoll(ChannelList *activeChannels) {
+void EPoller::poll(ChannelList *activeChannels) {
   int numEvents = ::epoll_wait(m_epollFd, m_events.data(),
                                static_cast<int>(m_events.size()), -1);
   int savedErrno = errno;
   if (numEvents > 0) {
-    std::cout << numEvents << " events happened";
+    LOG_TRACE << numEvents << " events happened";
     fillActiveChannels(numEvents, activeChannels);
     if (static_cast<size_t>(numEvents) == m_events.size()) {
       m_events.resize(m_events.size() * 2);
+      m_ownerLoop->stats().addEventListResize();
     }
   } else if (numEvents == 0) {
-    std::cout << "nothing happened";
+    LOG_TRACE << "nothing happened";
   } else {
     // error happens, log uncommon ones
     if (savedErrno != EINTR) {
       errno = savedErrno;
-      std::cout << "EPollPoller::poll()";
+      LOG_SYSERR << "EPollPoller::poll()";
     }
   }
 }
@@ -56,7 +58,19 @@ void EPoller::epoll(ChannelList *activeChannels) {
 void EPoller::fillActiveChannels(int numEvents,
                                  ChannelList *activeChannels) const {
   for (int i = 0; i < numEvents; ++i) {
-    Channel *channel = static_cast<Channel *>(m_events[i].data.ptr);
+    uint64_t data = m_events[i].data.u64;
+    int fd = static_cast<int>(static_cast<uint32_t>(data));
+    uint32_t generation = static_cast<uint32_t>(data >> 32);
+    const ChannelSlot *slot = static_cast<size_t>(fd) < m_channels.size()
+                                  ? &m_channels[fd]
+                                  : nullptr;
+    if (slot == nullptr || slot->channel == nullptr ||
+        slot->generation != generation) {
+      // Channel已经移除或fd已被复用，丢弃过期事件
+      LOG_TRACE << "stale event on fd = " << fd;
+      continue;
+    }
+    Channel *channel = slot->channel;
     channel->set_revents(m_events[i].events);
     activeChannels->push_back(channel);
   }
@@ -64,19 +78,26 @@ void EPoller::fillActiveChannels(int numEvents,
 
 void EPoller::updateChannel(Channel *channel) {
   const int index = channel->index();
-  std::cout << "fd = " << channel->fd() << " events = " << channel->events()
+  LOG_TRACE << "fd = " << channel->fd() << " events = " << channel->events()
             << " index = " << index;
   // 需要重新向红黑树中添加fd
   if (index == kNew || index == kDeleted) {
     if (index == kNew) {
-      int fd = channel->fd();
-      m_channels[fd] = channel;
+      size_t fd = static_cast<size_t>(channel->fd());
+      if (fd >= m_channels.size()) {
+        m_channels.resize(std::max(fd + 1, m_channels.size() * 2));
+      }
+      assert(m_channels[fd].channel == nullptr);
+      m_channels[fd].channel = channel;
+      ++m_channels[fd].generation;
+    } else {
+      assert(m_channels[channel->fd()].channel == channel);
     }
     channel->set_index(kAdded);
     update(EPOLL_CTL_ADD, channel);
   } else {
     // 如果当前不关注事件，从红黑树中删除fd
-    if (channel->isNoneEvent()) {
+    if (channel->pollEvents() == 0) {
       update(EPOLL_CTL_DEL, channel);
       channel->set_index(kDeleted);
     } else {
@@ -87,42 +108,43 @@ void EPoller::updateChannel(Channel *channel) {
 
 void EPoller::removeChannel(Channel *channel) {
   int fd = channel->fd();
-  std::cout << "fd = " << fd;
-  m_channels.erase(fd);
+  LOG_TRACE << "fd = " << fd;
+  assert(static_cast<size_t>(fd) < m_channels.size());
+  assert(m_channels[fd].channel == channel);
   if (channel->index() == kAdded) {
     update(EPOLL_CTL_DEL, channel);
   }
+  m_channels[fd].channel = nullptr;
+  ++m_channels[fd].generation;
   channel->set_index(kNew);
 }
 
 bool EPoller::hasChannel(Channel *channel) const {
   assertInLoopThread();
-  auto it = m_channels.find(channel->fd());
-  return (it != m_channels.end()) && (it->second == channel);
+  size_t fd = static_cast<size_t>(channel->fd());
+  return fd < m_channels.size() && m_channels[fd].channel == channel;
 }
 
 void EPoller::update(int operation, Channel *channel) {
   struct epoll_event event;
   memset(&event, 0, sizeof event);
-  event.events = channel->events();
-  event.data.ptr = channel;
+  event.events = channel->pollEvents();
   int fd = channel->fd();
-  std::cout << "epoll_ctl op = " << operationToString(operation)
+  event.data.u64 = makeEventData(fd);
+  LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
             << " fd = " << fd << " event = {" << channel->eventsToString()
             << "}";
   if (::epoll_ctl(m_epollFd, operation, fd, &event) < 0) {
     if (operation == EPOLL_CTL_DEL) {
-      std::cout << "epoll_ctl op =" << operationToString(operation)
-                << " fd =" << fd;
+      LOG_SYSERR << "epoll_ctl op =" << operationToString(operation)
+                 << " fd =" << fd;
     } else {
-      std::cout << "epoll_ctl op =" << operationToString(operation)
-                << " fd =" << fd;
+      LOG_SYSERR << "epoll_ctl op =" << operationToString(operation)
+                 << " fd =" << fd;
     }
   }
 }
 
-void EPoller::assertInLoopThread() const { m_ownerLoop->assertInLoopThread(); }
-
 const char *EPoller::operationToString(int op) {
   switch (op) {
   case EPOLL_CTL_ADD:
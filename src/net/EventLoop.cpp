@@ -9,11 +9,15 @@
  *
  */
 #include "net/EventLoop.h"
+#include "base/Logging.h"
 #include "net/Channel.h"
-#include "net/EPoller.h"
+#include "net/Poller.h"
 #include "net/SocketOps.h"
+#include "net/TCPConnection.h"
+#include "net/TimerQueue.h"
+#include "net/TimingWheel.h"
+#include <algorithm>
 #include <cassert>
-#include <iostream>
 #include <signal.h>
 #include <sys/eventfd.h>
 #include <sys/types.h>
@@ -33,7 +37,7 @@ __thread EventLoop *t_loopInThisThread = 0;
 int createEventfd() {
   int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
   if (evtfd < 0) {
-    std::cout << "Failed in eventfd";
+    LOG_SYSFATAL << "Failed in eventfd";
   }
   return evtfd;
 }
@@ -49,16 +53,21 @@ public:
     // LOG_TRACE << "Ignore
   };
 };
+IgnoreSigPipe initObj;
 } // namespace
 
-EventLoop::EventLoop()
-    : m_epoller(new EPoller(this)), m_wakeupFd(createEventfd()),
-      m_wakeupChannel(new Channel(this, m_wakeupFd)) {
-  std::cout << "EventLoop created " << this << " in thread " << m_threadId
-            << std::endl;
+EventLoop::EventLoop(Poller::Backend backend)
+    : m_poller(Poller::newPoller(this, backend)),
+      m_timerQueue(new TimerQueue(this)), m_timingWheel(new TimingWheel(this)),
+      m_wakeupFd(createEventfd()),
+      m_wakeupChannel(new Channel(this, m_wakeupFd)),
+      m_connectionSlab(std::make_shared<SlabPool>(sizeof(TCPConnection) +
+                                                  kControlBlockSlack)),
+      m_bufferPool(std::make_shared<BufferPool>()) {
+  LOG_DEBUG << "EventLoop created " << this << " in thread " << m_threadId;
   if (t_loopInThisThread) {
-    std::cout << "Another EventLoop " << t_loopInThisThread
-              << " exists in this thread " << m_threadId << std::endl;
+    LOG_ERROR << "Another EventLoop " << t_loopInThisThread
+              << " exists in this thread " << m_threadId;
   } else {
     t_loopInThisThread = this;
   }
@@ -71,7 +80,7 @@ EventLoop::EventLoop()
     uint64_t one = 1;
     ssize_t n = socket::read(m_wakeupFd, &one, sizeof one);
     if (n != sizeof one) {
-      std::cout << "EventLoop::handleRead() reads " << n
+      LOG_ERROR << "EventLoop::handleRead() reads " << n
                 << " bytes instead of 8";
     }
   };
@@ -81,12 +90,16 @@ EventLoop::EventLoop()
 }
 
 EventLoop::~EventLoop() {
-  std::cout << "EventLoop " << this << " of thread " << m_threadId
-            << " destructs in thread " << std::this_thread::get_id()
-            << std::endl;
+  LOG_DEBUG << "EventLoop " << this << " of thread " << m_threadId
+            << " destructs in thread " << std::this_thread::get_id();
   m_wakeupChannel->disableAll();
   m_wakeupChannel->remove();
   ::close(m_wakeupFd);
+  while (FunctorNode *node = m_pendingFunctors.pop()) {
+    if (!m_functorPool.owns(node)) {
+      delete node;
+    }
+  }
   t_loopInThisThread = nullptr;
 }
 
@@ -96,24 +109,78 @@ void EventLoop::loop() {
   m_looping = true;
   m_quit = false;
 
+  // 每轮取三次时间：poll之后、事件处理之后、任务执行之后(即下一轮poll之前)
+  int64_t pollStart = LoopStats::nowNanos();
   while (!m_quit) {
     m_activeChannels.clear();
-    // 从epoll中获取活跃的channel
-    m_epoller->epoll(&m_activeChannels);
+    m_busySince.store(0, std::memory_order_relaxed);
+    // 从poller中获取活跃的channel
+    m_poller->poll(&m_activeChannels);
+    int64_t handleStart = LoopStats::nowNanos();
+    m_busySince.store(handleStart, std::memory_order_relaxed);
+    m_stats.addPoll(m_activeChannels.size(), handleStart - pollStart);
     m_eventHandling = true;
-    for (Channel *channel : m_activeChannels) {
-      m_currentActiveChannel = channel;
-      channel->handleEvent();
+    if (m_slowCallbackNanos > 0) {
+      handleEventsTimed(handleStart);
+    } else {
+      for (Channel *channel : m_activeChannels) {
+        if (channel == nullptr) {
+          continue;
+        }
+        m_currentActiveChannel = channel;
+        m_dispatchingFd.store(channel->fd(), std::memory_order_relaxed);
+        channel->handleEvent();
+      }
     }
     m_currentActiveChannel = nullptr;
+    m_dispatchingFd.store(-1, std::memory_order_relaxed);
     m_eventHandling = false;
+    int64_t functorStart = LoopStats::nowNanos();
+    m_stats.addEventHandling(functorStart - handleStart);
     doPendingFunctors();
+    pollStart = LoopStats::nowNanos();
+    m_stats.addFunctorTime(pollStart - functorStart);
   }
 
-  std::cout << "EventLoop " << this << " stop looping" << std::endl;
+  LOG_TRACE << "EventLoop " << this << " stop looping";
+  m_busySince.store(0, std::memory_order_relaxed);
   m_looping = false;
 }
 
+void EventLoop::handleEventsTimed(int64_t start) {
+  for (Channel *channel : m_activeChannels) {
+    if (channel == nullptr) {
+      continue;
+    }
+    m_currentActiveChannel = channel;
+    m_dispatchingFd.store(channel->fd(), std::memory_order_relaxed);
+    channel->handleEvent();
+    int64_t end = LoopStats::nowNanos();
+    if (end - start > m_slowCallbackNanos) {
+      // Channel的销毁总是经由queueInLoop推迟到任务阶段，此时仍然有效
+      reportSlowCallback(channel, end - start);
+    }
+    start = end;
+  }
+}
+
+void EventLoop::reportSlowCallback(const Channel *channel, int64_t nanos) {
+  m_stats.addSlowCallback();
+  if (channel != nullptr) {
+    LOG_WARN << "EventLoop " << this << " slow callback on {"
+             << channel->reventsToString() << "} took " << nanos / 1000
+             << "us";
+  } else {
+    LOG_WARN << "EventLoop " << this << " slow pending functor took "
+             << nanos / 1000 << "us";
+  }
+}
+
+void EventLoop::setSlowCallbackThreshold(double seconds) {
+  int64_t nanos = static_cast<int64_t>(seconds * 1e9);
+  runInLoop([this, nanos]() { m_slowCallbackNanos = nanos; });
+}
+
 void EventLoop::quit() {
   m_quit = true;
   if (!isInLoopThread()) {
@@ -130,71 +197,132 @@ void EventLoop::runInLoop(Functor cb) {
 }
 
 void EventLoop::queueInLoop(Functor cb) {
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_pendingFunctors.push_back(std::move(cb));
+  FunctorNode *node = m_functorPool.acquire();
+  if (node == nullptr) {
+    node = new FunctorNode;
   }
+  node->functor = std::move(cb);
+  m_pendingCount.fetch_add(1);
+  m_pendingFunctors.push(node);
 
+  // 已经有未处理的唤醒时不再写eventfd
   if (!isInLoopThread() || m_callingPendingFunctors) {
-    wakeup();
+    if (!m_wakeupPending.exchange(true)) {
+      wakeup();
+    }
   }
 }
 
 size_t EventLoop::queueSize() const {
-  std::lock_guard<std::mutex> lock(m_mutex);
-  return m_pendingFunctors.size();
+  return m_pendingCount.load(std::memory_order_relaxed);
+}
+
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
+  return m_timerQueue->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
+  Timestamp time(Timestamp::now().addTime(delay));
+  return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
+  Timestamp time(Timestamp::now().addTime(interval));
+  return m_timerQueue->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId) {
+  return m_timerQueue->cancel(timerId);
 }
 
 void EventLoop::wakeup() {
   uint64_t one = 1;
   ssize_t n = socket::write(m_wakeupFd, &one, sizeof one);
   if (n != sizeof one) {
-    std::cout << "EventLoop::wakeup() writes " << n << " bytes instead of 8";
+    LOG_ERROR << "EventLoop::wakeup() writes " << n << " bytes instead of 8";
   }
 }
 
 void EventLoop::updateChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
-  m_epoller->updateChannel(channel);
+  m_poller->updateChannel(channel);
 }
 
 void EventLoop::removeChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
-  m_epoller->removeChannel(channel);
+  if (m_eventHandling) {
+    // 被本批中前面的回调移除的Channel，后面的项不能再分发
+    std::replace(m_activeChannels.begin(), m_activeChannels.end(), channel,
+                 static_cast<Channel *>(nullptr));
+  }
+  m_poller->removeChannel(channel);
 }
 
 bool EventLoop::hasChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
-  return m_epoller->hasChannel(channel);
+  return m_poller->hasChannel(channel);
 }
 
+bool EventLoop::completionIo() const { return m_poller->completionIo(); }
+
 void EventLoop::abortNotInLoopThread() {
-  std::cout << "EventLoop::abortNotInLoopThread - EventLoop " << this
+  LOG_ERROR << "EventLoop::abortNotInLoopThread - EventLoop " << this
             << " was created in threadId_ = " << m_threadId
-            << ", current thread id = " << std::this_thread::get_id()
-            << std::endl;
+            << ", current thread id = " << std::this_thread::get_id();
 }
 
 void EventLoop::doPendingFunctors() {
-  std::vector<Functor> functors;
   m_callingPendingFunctors = true;
-  // 交换pendingFunctors和functors，减小临界区
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    functors.swap(m_pendingFunctors);
-  }
-
-  for (const Functor &functor : functors) {
-    functor();
+  // 先清除唤醒标志再取任务，此后入队的任务一定会重新写eventfd
+  m_wakeupPending.exchange(false);
+  size_t pending = m_pendingCount.load();
+  size_t count = 0;
+  if (pending > 0) {
+    // 以分界节点为界，执行任务时新入队的任务留到下一轮，避免饿死epoll
+    m_pendingFunctors.push(&m_drainMarker);
+    for (;;) {
+      FunctorNode *node = m_pendingFunctors.pop();
+      if (node == nullptr) {
+        // 有生产者正在入队，分界节点之前的任务马上就会可见
+        std::this_thread::yield();
+        continue;
+      }
+      if (node == &m_drainMarker) {
+        break;
+      }
+      m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+      ++count;
+      if (m_slowCallbackNanos > 0) {
+        int64_t start = LoopStats::nowNanos();
+        node->functor();
+        int64_t nanos = LoopStats::nowNanos() - start;
+        if (nanos > m_slowCallbackNanos) {
+          reportSlowCallback(nullptr, nanos);
+        }
+      } else {
+        node->functor();
+      }
+      // 立即析构捕获的对象(如连接的shared_ptr)，再归还节点
+      node->functor = nullptr;
+      if (m_functorPool.owns(node)) {
+        m_functorPool.release(node);
+      } else {
+        delete node;
+      }
+    }
   }
   m_callingPendingFunctors = false;
+  m_stats.addFunctors(count, pending);
 }
 
 void EventLoop::printActiveChannels() const {
   for (const Channel *channel : m_activeChannels) {
-    std::cout << "{" << channel->reventsToString() << "} ";
+    if (channel == nullptr) {
+      continue;
+    }
+    LOG_TRACE << "{" << channel->reventsToString() << "} ";
   }
 }
\ No newline at end of file
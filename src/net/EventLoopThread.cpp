@@ -0,0 +1,61 @@
+/**
+ * @file EventLoopThread.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/EventLoopThread.h"
+#include "net/EventLoop.h"
+#include <cassert>
+using namespace neonet;
+
+EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
+                                 const std::string &name,
+                                 Poller::Backend backend)
+    : m_callback(cb), m_name(name), m_backend(backend) {}
+
+EventLoopThread::~EventLoopThread() {
+  m_exiting = true;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_loop != nullptr) {
+      m_loop->quit();
+    }
+  }
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+EventLoop *EventLoopThread::startLoop() {
+  assert(!m_thread.joinable());
+  m_thread = std::thread([this]() { threadFunc(); });
+
+  EventLoop *loop = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() { return m_loop != nullptr; });
+    loop = m_loop;
+  }
+  return loop;
+}
+
+void EventLoopThread::threadFunc() {
+  EventLoop loop(m_backend);
+  if (m_callback) {
+    m_callback(&loop);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loop = &loop;
+    m_cond.notify_one();
+  }
+
+  loop.loop();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_loop = nullptr;
+}
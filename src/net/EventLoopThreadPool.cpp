@@ -0,0 +1,56 @@
+/**
+ * @file EventLoopThreadPool.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/EventLoopThreadPool.h"
+#include "net/EventLoop.h"
+#include <cassert>
+using namespace neonet;
+
+EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,
+                                         const std::string &name)
+    : m_baseLoop(baseLoop), m_name(name) {}
+
+// 线程中的EventLoop都是栈上对象，不需要在这里删除
+EventLoopThreadPool::~EventLoopThreadPool() = default;
+
+void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
+  assert(!m_started);
+  m_baseLoop->assertInLoopThread();
+  m_started = true;
+
+  for (int i = 0; i < m_numThreads; ++i) {
+    std::string name = m_name + std::to_string(i);
+    m_threads.emplace_back(new EventLoopThread(cb, name, m_backend));
+    m_loops.push_back(m_threads.back()->startLoop());
+  }
+  if (m_numThreads == 0 && cb) {
+    cb(m_baseLoop);
+  }
+}
+
+EventLoop *EventLoopThreadPool::getNextLoop() {
+  m_baseLoop->assertInLoopThread();
+  assert(m_started);
+  EventLoop *loop = m_baseLoop;
+  if (!m_loops.empty()) {
+    loop = m_loops[m_next];
+    m_next = (m_next + 1) % m_loops.size();
+  }
+  return loop;
+}
+
+std::vector<EventLoop *> EventLoopThreadPool::getAllLoops() {
+  m_baseLoop->assertInLoopThread();
+  assert(m_started);
+  if (m_loops.empty()) {
+    return std::vector<EventLoop *>(1, m_baseLoop);
+  }
+  return m_loops;
+}
@@ -0,0 +1,538 @@
+/**
+ * @file IoUringPoller.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief io_uring后端的实现
+ * @version 0.1
+ * @date 2024-08-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/IoUringPoller.h"
+#include "base/Logging.h"
+#include "net/Buffer.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+using namespace neonet;
+
+namespace {
+const int kNew = -1;
+const int kAdded = 1;
+
+int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit,
+                                    minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ringFd, unsigned opcode, void *arg, unsigned nrArgs) {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, ringFd, opcode, arg, nrArgs));
+}
+
+void *mapRing(int ringFd, size_t size, off_t offset) {
+  void *mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd, offset);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+void *mapAnonymous(size_t size) {
+  void *mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+int fdOf(uint64_t data) {
+  return static_cast<int>(static_cast<uint32_t>(data));
+}
+uint16_t generationOf(uint64_t data) {
+  return static_cast<uint16_t>(data >> 40);
+}
+} // namespace
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop), m_channels(kInitChannelTableSize) {
+  if (!setupRing()) {
+    LOG_SYSERR << "Failed in io_uring_setup";
+    if (m_ringFd >= 0) {
+      ::close(m_ringFd);
+      m_ringFd = -1;
+    }
+    return;
+  }
+  m_completionIo = setupBufferRing();
+}
+
+IoUringPoller::~IoUringPoller() {
+  if (m_buffers != nullptr) {
+    ::munmap(m_buffers, static_cast<size_t>(kBufferCount) * kBufferSize);
+  }
+  if (m_bufRing != nullptr) {
+    ::munmap(m_bufRing, kBufferCount * sizeof(struct io_uring_buf));
+  }
+  if (m_sqesMem != nullptr) {
+    ::munmap(m_sqesMem, m_sqesMemSize);
+  }
+  if (m_cqMem != nullptr) {
+    ::munmap(m_cqMem, m_cqMemSize);
+  }
+  if (m_ringMem != nullptr) {
+    ::munmap(m_ringMem, m_ringMemSize);
+  }
+  // 关闭ring时内核取消所有在途请求
+  if (m_ringFd >= 0) {
+    ::close(m_ringFd);
+  }
+}
+
+bool IoUringPoller::setupRing() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof params);
+  // 只有loop线程提交，完成事件也只在等待时处理
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                 IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+  params.cq_entries = kCqEntries;
+  m_ringFd = ioUringSetup(kRingEntries, &params);
+  if (m_ringFd < 0 && errno == EINVAL) {
+    // 老内核不认识后面几个标志
+    memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCqEntries;
+    m_ringFd = ioUringSetup(kRingEntries, &params);
+  }
+  if (m_ringFd < 0) {
+    return false;
+  }
+
+  size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cqSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  m_ringMemSize = singleMmap ? std::max(sqSize, cqSize) : sqSize;
+  m_ringMem = mapRing(m_ringFd, m_ringMemSize, IORING_OFF_SQ_RING);
+  if (m_ringMem == nullptr) {
+    return false;
+  }
+  char *cqBase = static_cast<char *>(m_ringMem);
+  if (!singleMmap) {
+    m_cqMemSize = cqSize;
+    m_cqMem = mapRing(m_ringFd, m_cqMemSize, IORING_OFF_CQ_RING);
+    if (m_cqMem == nullptr) {
+      return false;
+    }
+    cqBase = static_cast<char *>(m_cqMem);
+  }
+  m_sqesMemSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  m_sqesMem = mapRing(m_ringFd, m_sqesMemSize, IORING_OFF_SQES);
+  if (m_sqesMem == nullptr) {
+    return false;
+  }
+
+  char *sqBase = static_cast<char *>(m_ringMem);
+  m_sq.head = reinterpret_cast<unsigned *>(sqBase + params.sq_off.head);
+  m_sq.tail = reinterpret_cast<unsigned *>(sqBase + params.sq_off.tail);
+  m_sq.array = reinterpret_cast<unsigned *>(sqBase + params.sq_off.array);
+  m_sq.mask = *reinterpret_cast<unsigned *>(sqBase + params.sq_off.ring_mask);
+  m_sq.entries =
+      *reinterpret_cast<unsigned *>(sqBase + params.sq_off.ring_entries);
+  m_sq.sqes = static_cast<struct io_uring_sqe *>(m_sqesMem);
+  m_cq.head = reinterpret_cast<unsigned *>(cqBase + params.cq_off.head);
+  m_cq.tail = reinterpret_cast<unsigned *>(cqBase + params.cq_off.tail);
+  m_cq.mask = *reinterpret_cast<unsigned *>(cqBase + params.cq_off.ring_mask);
+  m_cq.cqes =
+      reinterpret_cast<struct io_uring_cqe *>(cqBase + params.cq_off.cqes);
+  m_sqTail = *m_sq.tail;
+  return true;
+}
+
+bool IoUringPoller::setupBufferRing() {
+  const size_t ringSize = kBufferCount * sizeof(struct io_uring_buf);
+  void *ring = mapAnonymous(ringSize);
+  void *buffers = mapAnonymous(static_cast<size_t>(kBufferCount) * kBufferSize);
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof reg);
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+  reg.ring_entries = kBufferCount;
+  reg.bgid = kBufferGroup;
+  if (ring == nullptr || buffers == nullptr ||
+      ioUringRegister(m_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    // 不支持缓冲区环(5.19之前)，只使用poll
+    LOG_INFO << "io_uring provided buffer ring is unavailable";
+    if (ring != nullptr) {
+      ::munmap(ring, ringSize);
+    }
+    if (buffers != nullptr) {
+      ::munmap(buffers, static_cast<size_t>(kBufferCount) * kBufferSize);
+    }
+    return false;
+  }
+  m_bufRing = static_cast<struct io_uring_buf *>(ring);
+  m_buffers = static_cast<char *>(buffers);
+  for (unsigned bid = 0; bid < kBufferCount; ++bid) {
+    recycleBuffer(static_cast<uint16_t>(bid));
+  }
+  __atomic_store_n(&m_bufRing[0].resv, m_bufTail, __ATOMIC_RELEASE);
+  return true;
+}
+
+void IoUringPoller::recycleBuffer(uint16_t bid) {
+  // 只写addr/len/bid，第0项的resv是环的tail
+  struct io_uring_buf *buf = &m_bufRing[m_bufTail & (kBufferCount - 1)];
+  char *addr = m_buffers + static_cast<size_t>(bid) * kBufferSize;
+  buf->addr = reinterpret_cast<uint64_t>(addr);
+  buf->len = kBufferSize;
+  buf->bid = bid;
+  ++m_bufTail;
+}
+
+void IoUringPoller::poll(ChannelList *activeChannels) {
+  ++m_round;
+  // 上一轮分发之后再生成请求，水平触发的Channel在这里重新提交poll
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    sync(m_pending[i]);
+  }
+  m_pending.clear();
+
+  if (enter(1) < 0 && errno != EINTR) {
+    LOG_SYSERR << "IoUringPoller::poll()";
+  }
+
+  const uint16_t bufTail = m_bufTail;
+  unsigned head = *m_cq.head;
+  unsigned tail = __atomic_load_n(m_cq.tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    handleCompletion(m_cq.cqes[head & m_cq.mask], activeChannels);
+  }
+  __atomic_store_n(m_cq.head, head, __ATOMIC_RELEASE);
+  // 本轮归还的缓冲区一次性交还给内核
+  if (m_bufTail != bufTail) {
+    __atomic_store_n(&m_bufRing[0].resv, m_bufTail, __ATOMIC_RELEASE);
+  }
+}
+
+void IoUringPoller::updateChannel(Channel *channel) {
+  size_t fd = static_cast<size_t>(channel->fd());
+  if (channel->index() == kNew) {
+    if (fd >= m_channels.size()) {
+      m_channels.resize(std::max(fd + 1, m_channels.size() * 2));
+    }
+    ChannelSlot &slot = m_channels[fd];
+    assert(slot.channel == nullptr);
+    slot.channel = channel;
+    ++slot.generation;
+    channel->set_index(kAdded);
+  } else {
+    assert(m_channels[fd].channel == channel);
+  }
+  markPending(channel->fd());
+}
+
+void IoUringPoller::removeChannel(Channel *channel) {
+  int fd = channel->fd();
+  assert(static_cast<size_t>(fd) < m_channels.size());
+  ChannelSlot &slot = m_channels[fd];
+  assert(slot.channel == channel);
+  if (slot.pollData != 0) {
+    submitCancel(slot.pollData);
+    slot.pollData = 0;
+  }
+  if (slot.readData != 0) {
+    submitCancel(slot.readData);
+    slot.readData = 0;
+  }
+  slot.pollMask = 0;
+  slot.channel = nullptr;
+  ++slot.generation;
+  // 完成模式下还没有取走的连接
+  std::vector<int> &accepted = channel->completions()->accepted;
+  for (int connfd : accepted) {
+    ::close(connfd);
+  }
+  accepted.clear();
+  channel->set_index(kNew);
+}
+
+bool IoUringPoller::hasChannel(Channel *channel) const {
+  assertInLoopThread();
+  size_t fd = static_cast<size_t>(channel->fd());
+  return fd < m_channels.size() && m_channels[fd].channel == channel;
+}
+
+void IoUringPoller::markPending(int fd) {
+  ChannelSlot &slot = m_channels[fd];
+  if (!slot.pending) {
+    slot.pending = true;
+    m_pending.push_back(fd);
+  }
+}
+
+void IoUringPoller::sync(int fd) {
+  ChannelSlot &slot = m_channels[fd];
+  slot.pending = false;
+  Channel *channel = slot.channel;
+  if (channel == nullptr) {
+    return;
+  }
+
+  // 完成模式：关注读事件期间保持一个multishot recv/accept
+  Op readOp = kNoOp;
+  if (channel->completionRecv()) {
+    readOp = kRecv;
+  } else if (channel->completionAccept()) {
+    readOp = kAccept;
+  }
+  const bool wantRead = readOp != kNoOp && channel->isReading();
+  if (wantRead && slot.readData == 0) {
+    slot.readData = makeData(readOp, fd, &slot);
+    if (readOp == kRecv) {
+      submitRecv(fd, slot.readData);
+    } else {
+      submitAccept(fd, slot.readData);
+    }
+  } else if (!wantRead && slot.readData != 0) {
+    submitCancel(slot.readData);
+    slot.readData = 0;
+  }
+
+  // 就绪通知：完成模式只关注可写
+  uint32_t mask = 0;
+  bool multishot = false;
+  if (channel->completionMode()) {
+    mask = static_cast<uint32_t>(channel->events()) & EPOLLOUT;
+  } else {
+    mask = static_cast<uint32_t>(channel->pollEvents()) &
+           ~static_cast<uint32_t>(EPOLLET);
+    multishot = channel->isEdgeTriggered();
+  }
+  if (slot.pollData != 0 && slot.pollMask != mask) {
+    submitCancel(slot.pollData);
+    slot.pollData = 0;
+  }
+  if (slot.pollData == 0 && mask != 0) {
+    slot.pollData = makeData(kPoll, fd, &slot);
+    slot.pollMask = mask;
+    submitPoll(fd, slot.pollData, mask, multishot);
+  }
+}
+
+void IoUringPoller::handleCompletion(const struct io_uring_cqe &cqe,
+                                     ChannelList *activeChannels) {
+  const uint64_t data = cqe.user_data;
+  const Op op = static_cast<Op>(data >> 56);
+  if (op == kCancel || op == kNoOp) {
+    return;
+  }
+  int fd = fdOf(data);
+  ChannelSlot *slot = static_cast<size_t>(fd) < m_channels.size()
+                          ? &m_channels[fd]
+                          : nullptr;
+  if (slot == nullptr || slot->channel == nullptr ||
+      slot->generation != generationOf(data)) {
+    // Channel已经移除或fd已被复用
+    discard(cqe);
+    return;
+  }
+  // 已经取消的旧请求仍属于这个Channel，它的结果照常交付，但不影响在途状态
+  uint64_t &inflight = op == kPoll ? slot->pollData : slot->readData;
+  const bool finished =
+      inflight == data && !(cqe.flags & IORING_CQE_F_MORE);
+  if (finished) {
+    inflight = 0;
+  }
+  switch (op) {
+  case kPoll:
+    handlePoll(slot, cqe, finished, activeChannels);
+    break;
+  case kRecv:
+    handleRecv(slot, cqe, finished, activeChannels);
+    break;
+  case kAccept:
+    handleAccept(slot, cqe, finished, activeChannels);
+    break;
+  default:
+    break;
+  }
+}
+
+void IoUringPoller::handlePoll(ChannelSlot *slot,
+                               const struct io_uring_cqe &cqe, bool finished,
+                               ChannelList *activeChannels) {
+  int fd = slot->channel->fd();
+  if (cqe.res > 0) {
+    activate(slot, cqe.res, activeChannels);
+  } else if (cqe.res < 0 && cqe.res != -ECANCELED) {
+    LOG_ERROR << "IoUringPoller poll error fd = " << fd << " "
+              << strerror_tl(-cqe.res);
+    return;
+  }
+  // 单次poll触发之后，或multishot被内核结束时，在下一轮重新提交
+  if (finished) {
+    markPending(fd);
+  }
+}
+
+void IoUringPoller::handleRecv(ChannelSlot *slot,
+                               const struct io_uring_cqe &cqe, bool finished,
+                               ChannelList *activeChannels) {
+  Channel *channel = slot->channel;
+  Channel::Completions *completions = channel->completions();
+  if (cqe.res > 0) {
+    assert(cqe.flags & IORING_CQE_F_BUFFER);
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (channel->recvBuffer() != nullptr) {
+      channel->recvBuffer()->append(
+          m_buffers + static_cast<size_t>(bid) * kBufferSize,
+          static_cast<size_t>(cqe.res));
+      completions->received += static_cast<size_t>(cqe.res);
+      activate(slot, EPOLLIN, activeChannels);
+    }
+    recycleBuffer(bid);
+    if (finished) {
+      markPending(channel->fd());
+    }
+  } else if (cqe.res == 0) {
+    completions->eof = true;
+    activate(slot, EPOLLIN | EPOLLRDHUP, activeChannels);
+  } else if (cqe.res == -ENOBUFS) {
+    // 缓冲区暂时用完，本轮归还之后重新提交
+    if (finished) {
+      markPending(channel->fd());
+    }
+  } else if (cqe.res == -EINVAL) {
+    disableCompletion(slot);
+  } else if (cqe.res != -ECANCELED) {
+    completions->error = -cqe.res;
+    activate(slot, EPOLLIN, activeChannels);
+  }
+}
+
+void IoUringPoller::handleAccept(ChannelSlot *slot,
+                                 const struct io_uring_cqe &cqe, bool finished,
+                                 ChannelList *activeChannels) {
+  Channel *channel = slot->channel;
+  Channel::Completions *completions = channel->completions();
+  if (cqe.res >= 0) {
+    completions->accepted.push_back(cqe.res);
+    activate(slot, EPOLLIN, activeChannels);
+  } else if (cqe.res == -EINVAL) {
+    disableCompletion(slot);
+    return;
+  } else if (cqe.res != -ECANCELED) {
+    // EMFILE等错误会结束multishot accept，交给Acceptor处理后重新提交
+    completions->error = -cqe.res;
+    activate(slot, EPOLLIN, activeChannels);
+  }
+  if (finished) {
+    markPending(channel->fd());
+  }
+}
+
+void IoUringPoller::discard(const struct io_uring_cqe &cqe) {
+  if (cqe.flags & IORING_CQE_F_BUFFER) {
+    recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+  }
+  if (static_cast<Op>(cqe.user_data >> 56) == kAccept && cqe.res >= 0) {
+    ::close(cqe.res);
+  }
+}
+
+void IoUringPoller::activate(ChannelSlot *slot, int revents,
+                             ChannelList *activeChannels) {
+  Channel *channel = slot->channel;
+  if (slot->activeRound != m_round) {
+    slot->activeRound = m_round;
+    channel->set_revents(revents);
+    activeChannels->push_back(channel);
+  } else {
+    channel->set_revents(channel->revents() | revents);
+  }
+}
+
+void IoUringPoller::disableCompletion(ChannelSlot *slot) {
+  // multishot recv/accept需要6.0以上的内核
+  LOG_INFO << "io_uring multishot recv/accept is unsupported, fall back to "
+              "poll";
+  m_completionIo = false;
+  Channel *channel = slot->channel;
+  channel->setCompletionRecv(nullptr);
+  channel->setCompletionAccept(false);
+  markPending(channel->fd());
+}
+
+struct io_uring_sqe *IoUringPoller::getSqe() {
+  // 没有SQPOLL，提交时内核同步取走所有提交项
+  while (m_sqTail - __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE) >=
+         m_sq.entries) {
+    enter(0);
+  }
+  unsigned index = m_sqTail & m_sq.mask;
+  struct io_uring_sqe *sqe = &m_sq.sqes[index];
+  memset(sqe, 0, sizeof *sqe);
+  m_sq.array[index] = index;
+  ++m_sqTail;
+  return sqe;
+}
+
+uint64_t IoUringPoller::makeData(Op op, int fd, ChannelSlot *slot) {
+  ++slot->sequence;
+  return (static_cast<uint64_t>(op) << 56) |
+         (static_cast<uint64_t>(slot->generation) << 40) |
+         (static_cast<uint64_t>(slot->sequence) << 32) |
+         static_cast<uint32_t>(fd);
+}
+
+void IoUringPoller::submitPoll(int fd, uint64_t data, uint32_t mask,
+                               bool multishot) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = mask;
+  sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = data;
+}
+
+void IoUringPoller::submitRecv(int fd, uint64_t data) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = data;
+}
+
+void IoUringPoller::submitAccept(int fd, uint64_t data) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = data;
+}
+
+void IoUringPoller::submitCancel(uint64_t target) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = target;
+  sqe->user_data = static_cast<uint64_t>(kCancel) << 56;
+}
+
+int IoUringPoller::enter(unsigned minComplete) {
+  __atomic_store_n(m_sq.tail, m_sqTail, __ATOMIC_RELEASE);
+  unsigned toSubmit = m_sqTail - __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE);
+  unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  return ioUringEnter(m_ringFd, toSubmit, minComplete, flags);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file LoopStats.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief EventLoop运行统计的快照
+ * @version 0.1
+ * @date 2024-08-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/LoopStats.h"
+#include <cstdio>
+using namespace neonet;
+
+LoopStats::Snapshot LoopStats::snapshot() const {
+  Snapshot s;
+  s.timeNanos = nowNanos();
+  s.polls = m_polls.load(std::memory_order_relaxed);
+  s.events = m_events.load(std::memory_order_relaxed);
+  s.pollNanos = m_pollNanos.load(std::memory_order_relaxed);
+  s.eventNanos = m_eventNanos.load(std::memory_order_relaxed);
+  s.functorNanos = m_functorNanos.load(std::memory_order_relaxed);
+  s.functors = m_functors.load(std::memory_order_relaxed);
+  s.eventListResizes = m_eventListResizes.load(std::memory_order_relaxed);
+  s.slowCallbacks = m_slowCallbacks.load(std::memory_order_relaxed);
+  s.maxEventsPerPoll = m_maxEventsPerPoll.load(std::memory_order_relaxed);
+  s.pendingHighWater = m_pendingHighWater.load(std::memory_order_relaxed);
+  return s;
+}
+
+LoopStats::Snapshot
+LoopStats::Snapshot::operator-(const Snapshot &earlier) const {
+  Snapshot d(*this);
+  d.timeNanos -= earlier.timeNanos;
+  d.polls -= earlier.polls;
+  d.events -= earlier.events;
+  d.pollNanos -= earlier.pollNanos;
+  d.eventNanos -= earlier.eventNanos;
+  d.functorNanos -= earlier.functorNanos;
+  d.functors -= earlier.functors;
+  d.eventListResizes -= earlier.eventListResizes;
+  d.slowCallbacks -= earlier.slowCallbacks;
+  return d;
+}
+
+std::string LoopStats::Snapshot::toString() const {
+  char buf[256];
+  ::snprintf(buf, sizeof(buf),
+             "polls %llu, events/poll %.2f (max %llu), poll %.1fms, "
+             "events %.1fms, functors %llu in %.1fms (queue max %llu), "
+             "event list resizes %llu, slow callbacks %llu",
+             static_cast<unsigned long long>(polls), eventsPerPoll(),
+             static_cast<unsigned long long>(maxEventsPerPoll),
+             pollNanos / 1e6, eventNanos / 1e6,
+             static_cast<unsigned long long>(functors), functorNanos / 1e6,
+             static_cast<unsigned long long>(pendingHighWater),
+             static_cast<unsigned long long>(eventListResizes),
+             static_cast<unsigned long long>(slowCallbacks));
+  return buf;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file LoopWatchdog.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 停顿检测的实现
+ * @version 0.1
+ * @date 2024-08-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/LoopWatchdog.h"
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/LoopStats.h"
+#include <algorithm>
+#include <chrono>
+using namespace neonet;
+
+namespace {
+void defaultStallCallback(EventLoop *loop, double seconds, int fd) {
+  if (fd >= 0) {
+    LOG_WARN << "EventLoop " << loop << " of thread " << loop->threadId()
+             << " has not returned to poll for " << seconds * 1000
+             << "ms, handling fd " << fd;
+  } else {
+    LOG_WARN << "EventLoop " << loop << " of thread " << loop->threadId()
+             << " has not returned to poll for " << seconds * 1000
+             << "ms, running pending functors";
+  }
+}
+} // namespace
+
+LoopWatchdog::LoopWatchdog(double stallThreshold, double checkInterval)
+    : m_stallNanos(static_cast<int64_t>(stallThreshold * 1e9)),
+      m_intervalNanos(static_cast<int64_t>(
+          (checkInterval > 0 ? checkInterval : stallThreshold / 2) * 1e9)),
+      m_stallCallback(defaultStallCallback) {}
+
+LoopWatchdog::~LoopWatchdog() { stop(); }
+
+void LoopWatchdog::watch(EventLoop *loop) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.push_back(Entry{loop});
+}
+
+void LoopWatchdog::unwatch(EventLoop *loop) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                 [loop](const Entry &entry) {
+                                   return entry.loop == loop;
+                                 }),
+                  m_entries.end());
+}
+
+void LoopWatchdog::setStallCallback(StallCallback cb) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stallCallback = std::move(cb);
+}
+
+void LoopWatchdog::start() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_running) {
+    return;
+  }
+  m_running = true;
+  m_thread = std::thread([this]() { threadFunc(); });
+}
+
+void LoopWatchdog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+      return;
+    }
+    m_running = false;
+  }
+  m_cond.notify_one();
+  m_thread.join();
+}
+
+void LoopWatchdog::threadFunc() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_running) {
+    m_cond.wait_for(lock, std::chrono::nanoseconds(m_intervalNanos));
+    if (m_running) {
+      check(LoopStats::nowNanos());
+    }
+  }
+}
+
+void LoopWatchdog::check(int64_t now) {
+  for (Entry &entry : m_entries) {
+    int64_t since = entry.loop->busySince();
+    if (since == 0 || since == entry.reportedSince ||
+        now - since < m_stallNanos) {
+      continue;
+    }
+    entry.reportedSince = since;
+    m_stalls.fetch_add(1, std::memory_order_relaxed);
+    if (m_stallCallback) {
+      m_stallCallback(entry.loop, static_cast<double>(now - since) / 1e9,
+                      entry.loop->dispatchingFd());
+    }
+  }
+}
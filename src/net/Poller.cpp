@@ -0,0 +1,39 @@
+/**
+ * @file Poller.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 创建Poller后端
+ * @version 0.1
+ * @date 2024-08-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/Poller.h"
+#include "base/Logging.h"
+#include "net/EPoller.h"
+#include "net/EventLoop.h"
+#include "net/IoUringPoller.h"
+#include <cstdlib>
+#include <cstring>
+using namespace neonet;
+
+void Poller::assertInLoopThread() const { m_ownerLoop->assertInLoopThread(); }
+
+std::unique_ptr<Poller> Poller::newPoller(EventLoop *loop, Backend backend) {
+  if (backend == kIoUring) {
+    std::unique_ptr<IoUringPoller> poller(new IoUringPoller(loop));
+    if (poller->valid()) {
+      return poller;
+    }
+    LOG_WARN << "io_uring is unavailable, fall back to epoll";
+  }
+  return std::unique_ptr<Poller>(new EPoller(loop));
+}
+
+Poller::Backend Poller::defaultBackend() {
+  const char *name = ::getenv("NEONET_POLLER");
+  if (name != nullptr && ::strcmp(name, "io_uring") == 0) {
+    return kIoUring;
+  }
+  return kEpoll;
+}
@@ -63,8 +63,8 @@ int Socket::setNonblock() {
   return SUCCESS;
 }
 
-int Socket::setNoDelay() {
-  int opt = 1;
+int Socket::setNoDelay(bool on) {
+  int opt = on ? 1 : 0;
   if (setsockopt(m_sockfd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) < 0) {
     strerror(errno);
     throw std::logic_error("Socket: setNoDelay() Error");
@@ -72,8 +72,8 @@ int Socket::setNoDelay() {
   return SUCCESS;
 }
 
-int Socket::setKeepAlive() {
-  int opt = 1;
+int Socket::setKeepAlive(bool on) {
+  int opt = on ? 1 : 0;
   if (setsockopt(m_sockfd, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) < 0) {
     strerror(errno);
     throw std::logic_error("Socket: setKeepAlive() Error");
@@ -91,7 +91,10 @@ int Socket::bind(const NetAddress &addr, bool reuse) {
 }
 
 int Socket::listen(int backlog) {
-  socket::listen(backlog);
+  if (::listen(m_sockfd, backlog) < 0) {
+    strerror(errno);
+    throw std::logic_error("Socket: listen() Error");
+  }
   return SUCCESS;
 }
 
@@ -112,3 +115,8 @@ int Socket::connect(const NetAddress &addr) {
   }
   return SUCCESS;
 }
+
+int Socket::shutdownWrite() {
+  socket::shutdownWrite(m_sockfd);
+  return SUCCESS;
+}
@@ -11,6 +11,7 @@
 
 #include "net/SocketOps.h"
 #include "Config.h"
+#include "base/Logging.h"
 #include "tools/Bytetransform.h"
 #include "tools/memtools.h"
 #include <cassert>
@@ -19,8 +20,9 @@
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
-#include <iostream>
-#include <sys/uio.h> // readv
+#include <sys/ioctl.h> // FIONREAD
+#include <sys/sendfile.h>
+#include <sys/uio.h>   // readv, writev
 #include <unistd.h>
 using namespace neonet;
 
@@ -39,7 +41,7 @@ int socket::createNonblocking() {
   int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
                         IPPROTO_TCP);
   if (sockfd < 0) {
-    std::cout << "sockets::createNonblockingOrDie";
+    LOG_SYSERR << "sockets::createNonblockingOrDie";
   }
   return sockfd;
 }
@@ -48,14 +50,14 @@ void socket::bind(int sockfd, const struct sockaddr *addr) {
   int ret =
       ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
   if (ret < 0) {
-    std::cout << "sockets::bindOrDie";
+    LOG_SYSERR << "sockets::bindOrDie";
   }
 }
 
 void socket::listen(int sockfd) {
   int ret = ::listen(sockfd, BACKLOG);
   if (ret < 0) {
-    std::cout << "sockets::listenOrDie";
+    LOG_SYSERR << "sockets::listenOrDie";
   }
 }
 
@@ -68,7 +70,9 @@ int socket::accept(int sockfd, struct sockaddr_in *addr) {
 
   if (connfd < 0) {
     int savedErrno = errno;
-    std::cout << "Socket::accept";
+    if (savedErrno != EAGAIN) {
+      LOG_SYSERR << "Socket::accept";
+    }
     switch (savedErrno) {
     case EAGAIN:
     case ECONNABORTED:
@@ -88,12 +92,14 @@ int socket::accept(int sockfd, struct sockaddr_in *addr) {
     case ENOTSOCK:
     case EOPNOTSUPP:
       // unexpected errors
-      std::cout << "unexpected error of ::accept " << savedErrno;
+      LOG_ERROR << "unexpected error of ::accept " << savedErrno;
       break;
     default:
-      std::cout << "unknown error of ::accept " << savedErrno;
+      LOG_ERROR << "unknown error of ::accept " << savedErrno;
       break;
     }
+    // 调用方据errno决定是否重试，不能让日志改写它
+    errno = savedErrno;
   }
   return connfd;
 }
@@ -115,15 +121,23 @@ ssize_t socket::write(int sockfd, const void *buf, size_t count) {
   return ::write(sockfd, buf, count);
 }
 
+ssize_t socket::writev(int sockfd, const struct iovec *iov, int iovcnt) {
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t socket::sendfile(int sockfd, int fileFd, off_t *offset, size_t count) {
+  return ::sendfile(sockfd, fileFd, offset, count);
+}
+
 void socket::close(int sockfd) {
   if (::close(sockfd) < 0) {
-    std::cout << "sockets::close";
+    LOG_SYSERR << "sockets::close";
   }
 }
 
 void socket::shutdownWrite(int sockfd) {
   if (::shutdown(sockfd, SHUT_WR) < 0) {
-    std::cout << "sockets::shutdownWrite";
+    LOG_SYSERR << "sockets::shutdownWrite";
   }
 }
 
@@ -149,7 +163,7 @@ void socket::fromIpPort(const char *ip, uint16_t port,
   addr->sin_family = AF_INET;
   addr->sin_port = hostToNetwork16(port);
   if (::inet_pton(AF_INET, ip, &addr->sin_addr) <= 0) {
-    std::cout << "sockets::fromIpPort";
+    LOG_SYSERR << "sockets::fromIpPort";
   }
 }
 
@@ -164,12 +178,20 @@ int socket::getSocketError(int sockfd) {
   }
 }
 
+int socket::bytesAvailable(int sockfd) {
+  int n = 0;
+  if (::ioctl(sockfd, FIONREAD, &n) < 0) {
+    return -1;
+  }
+  return n;
+}
+
 struct sockaddr socket::getLocalAddr(int sockfd) {
   struct sockaddr localaddr;
   memZero(&localaddr, sizeof localaddr);
   socklen_t addrlen = static_cast<socklen_t>(sizeof localaddr);
   if (::getsockname(sockfd, &localaddr, &addrlen) < 0) {
-    std::cout << "sockets::getLocalAddr";
+    LOG_SYSERR << "sockets::getLocalAddr";
   }
   return localaddr;
 }
@@ -179,7 +201,7 @@ struct sockaddr socket::getPeerAddr(int sockfd) {
   memZero(&peeraddr, sizeof peeraddr);
   socklen_t addrlen = static_cast<socklen_t>(sizeof peeraddr);
   if (::getpeername(sockfd, &peeraddr, &addrlen) < 0) {
-    std::cout << "sockets::getPeerAddr";
+    LOG_SYSERR << "sockets::getPeerAddr";
   }
   return peeraddr;
 }
@@ -0,0 +1,79 @@
+/**
+ * @file SplicePipe.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief splice转发管道的实现
+ * @version 0.1
+ * @date 2024-08-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/SplicePipe.h"
+#include "base/Logging.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace neonet;
+
+SplicePipe::SplicePipe(size_t pipeSize) {
+  int fds[2];
+  if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+    LOG_SYSERR << "SplicePipe::SplicePipe pipe2 failed";
+    return;
+  }
+  m_readFd = fds[0];
+  m_writeFd = fds[1];
+  // 超过/proc/sys/fs/pipe-max-size时失败，保留默认的容量
+  ::fcntl(m_writeFd, F_SETPIPE_SZ, static_cast<int>(pipeSize));
+}
+
+SplicePipe::~SplicePipe() {
+  if (valid()) {
+    ::close(m_readFd);
+    ::close(m_writeFd);
+  }
+}
+
+ssize_t SplicePipe::spliceFrom(int fd, size_t len, int *savedErrno) {
+  ssize_t n = ::splice(fd, nullptr, m_writeFd, nullptr, len,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n < 0) {
+    *savedErrno = errno;
+  }
+  return n;
+}
+
+ssize_t SplicePipe::spliceTo(int fd, size_t len, int *savedErrno) {
+  ssize_t n = ::splice(m_readFd, nullptr, fd, nullptr, len,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else if (n > 0) {
+    notifyWritable();
+  }
+  return n;
+}
+
+void SplicePipe::discard(size_t len) {
+  char buf[16 * 1024];
+  while (len > 0) {
+    ssize_t n = ::read(m_readFd, buf, std::min(len, sizeof buf));
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    len -= static_cast<size_t>(n);
+  }
+  notifyWritable();
+}
+
+void SplicePipe::notifyWritable() {
+  // 源连接先设置标志再重试一次splice，这里先取走数据再检查标志，
+  // 两者至少有一方能看到对方的操作，不会丢失唤醒
+  if (m_writerWaiting.exchange(false) && m_writableCallback) {
+    m_writableCallback();
+  }
+}
@@ -0,0 +1,822 @@
+/**
+ * @file TCPConnection.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief TCP连接的实现
+ * @version 0.1
+ * @date 2024-07-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/TCPConnection.h"
+#include "base/Logging.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/Socket.h"
+#include "net/SocketOps.h"
+#include "net/SplicePipe.h"
+#include <algorithm>
+#include <cassert>
+#include <errno.h>
+#include <fcntl.h>
+using namespace neonet;
+
+void neonet::defaultConnectionCallback(const TcpConnectionPtr &conn) {
+  LOG_TRACE << conn->localAddress().getIp() << ":"
+            << conn->localAddress().getPort() << " -> "
+            << conn->peerAddress().getIp() << ":"
+            << conn->peerAddress().getPort() << " is "
+            << (conn->connected() ? "UP" : "DOWN");
+}
+
+void neonet::defaultMessageCallback(const TcpConnectionPtr &, Buffer *buf) {
+  buf->retrieveAll();
+}
+
+TCPConnection::TCPConnection(EventLoop *loop, const std::string &name,
+                             int sockfd, const NetAddress &localAddr,
+                             const NetAddress &peerAddr)
+    : m_loop(loop), m_name(name), m_state(kConnecting), m_reading(true),
+      m_socket(sockfd), m_channel(loop, sockfd),
+      m_localAddr(localAddr), m_peerAddr(peerAddr),
+      m_highWaterMark(64 * 1024 * 1024),
+      m_inputBuffer(loop->bufferPool()), m_outputBuffer(loop->bufferPool()) {
+  m_channel.setReadCallback([this]() { handleRead(); });
+  m_channel.setWriteCallback([this]() { handleWrite(); });
+  m_channel.setCloseCallback([this]() { handleClose(); });
+  m_channel.setErrorCallback([this]() { handleError(); });
+  // 超时项只在连接建立之后、销毁之前挂在时间轮上，此时连接一定存活
+  m_idleEntry.setCallback([this]() {
+    LOG_INFO << "TCPConnection [" << m_name << "] idle timeout";
+    forceClose();
+  });
+  m_socket.setKeepAlive(true);
+  // 后端支持时，数据由poller直接收取到m_inputBuffer中
+  if (m_loop->completionIo()) {
+    m_channel.setCompletionRecv(&m_inputBuffer);
+  }
+}
+
+TCPConnection::~TCPConnection() { assert(m_state == kDisconnected); }
+
+void TCPConnection::send(const void *message, int len) {
+  if (m_state != kConnected) {
+    return;
+  }
+  if (m_loop->isInLoopThread()) {
+    sendInLoop(message, len);
+  } else {
+    // 跨线程发送需要拷贝一份数据，并持有连接防止提前析构
+    std::string data(static_cast<const char *>(message), len);
+    auto self = shared_from_this();
+    m_loop->runInLoop([self, data = std::move(data)]() {
+      self->sendInLoop(data.data(), data.size());
+    });
+  }
+}
+
+void TCPConnection::send(Buffer *message) {
+  if (m_state != kConnected) {
+    return;
+  }
+  if (message->mirrored()) {
+    // 环形存储是连接的输入缓冲，不能移交，只拷贝出可读数据
+    send(message->peek(), static_cast<int>(message->readableBytes()));
+    message->retrieveAll();
+    return;
+  }
+  // 取走message的存储，交给输出缓冲链，调用方得到一个空的Buffer
+  Buffer buf(std::move(*message));
+  if (m_loop->isInLoopThread()) {
+    sendInLoop(std::move(buf));
+  } else {
+    auto self = shared_from_this();
+    m_loop->runInLoop([self, buf = std::move(buf)]() mutable {
+      self->sendInLoop(std::move(buf));
+    });
+  }
+}
+
+bool TCPConnection::sendFile(int fd, off_t offset, size_t length) {
+  if (m_state != kConnected) {
+    return false;
+  }
+  // 复制的fd归输出缓冲链所有，不受调用方关闭fd的影响
+  int file = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (file < 0) {
+    LOG_SYSERR << "TCPConnection::sendFile";
+    return false;
+  }
+  if (m_loop->isInLoopThread()) {
+    sendFileInLoop(file, offset, length);
+  } else {
+    auto self = shared_from_this();
+    m_loop->runInLoop([self, file, offset, length]() {
+      self->sendFileInLoop(file, offset, length);
+    });
+  }
+  return true;
+}
+
+void TCPConnection::sendInLoop(const void *message, size_t len) {
+  m_loop->assertInLoopThread();
+  ssize_t nwrote = 0;
+  size_t remaining = len;
+  bool faultError = false;
+  if (m_state == kDisconnected) {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  // 输出缓冲链为空时直接写socket
+  if (!m_channel.isWriting() && m_outputBuffer.empty()) {
+    nwrote = socket::write(m_channel.fd(), message, len);
+    if (nwrote >= 0) {
+      remaining = len - nwrote;
+      if (remaining == 0 && m_writeCompleteCallback) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->m_writeCompleteCallback(self); });
+      }
+    } else {
+      nwrote = 0;
+      if (errno != EWOULDBLOCK) {
+        LOG_SYSERR << "TCPConnection::sendInLoop";
+        if (errno == EPIPE || errno == ECONNRESET) {
+          faultError = true;
+        }
+      }
+    }
+  }
+
+  assert(remaining <= len);
+  if (!faultError && remaining > 0) {
+    checkHighWaterMark(m_outputBuffer.readableBytes(), remaining);
+    m_outputBuffer.append(static_cast<const char *>(message) + nwrote,
+                          remaining);
+    if (!m_channel.isWriting()) {
+      m_channel.enableWriting();
+    }
+  }
+}
+
+void TCPConnection::sendInLoop(Buffer &&message) {
+  m_loop->assertInLoopThread();
+  if (m_state == kDisconnected) {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  if (!m_channel.isWriting() && m_outputBuffer.empty()) {
+    ssize_t nwrote = socket::write(m_channel.fd(), message.peek(),
+                                   message.readableBytes());
+    if (nwrote >= 0) {
+      message.retrieve(nwrote);
+      if (message.readableBytes() == 0 && m_writeCompleteCallback) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->m_writeCompleteCallback(self); });
+      }
+    } else if (errno != EWOULDBLOCK) {
+      LOG_SYSERR << "TCPConnection::sendInLoop";
+      if (errno == EPIPE || errno == ECONNRESET) {
+        return;
+      }
+    }
+  }
+
+  if (message.readableBytes() > 0) {
+    checkHighWaterMark(m_outputBuffer.readableBytes(),
+                       message.readableBytes());
+    m_outputBuffer.append(std::move(message));
+    if (!m_channel.isWriting()) {
+      m_channel.enableWriting();
+    }
+  }
+}
+
+void TCPConnection::sendPipe(const std::shared_ptr<SplicePipe> &pipe,
+                             size_t len) {
+  // 管道中的数据必须被取走，即使连接已经关闭也要交给loop丢弃
+  if (m_loop->isInLoopThread()) {
+    sendPipeInLoop(pipe, len);
+  } else {
+    auto self = shared_from_this();
+    m_loop->runInLoop(
+        [self, pipe, len]() { self->sendPipeInLoop(pipe, len); });
+  }
+}
+
+void TCPConnection::sendPipeInLoop(const std::shared_ptr<SplicePipe> &pipe,
+                                   size_t len) {
+  m_loop->assertInLoopThread();
+  if (m_state == kDisconnected) {
+    pipe->discard(len);
+    return;
+  }
+  size_t remaining = len;
+  if (!m_channel.isWriting() && m_outputBuffer.empty()) {
+    int savedErrno = 0;
+    ssize_t nwrote = pipe->spliceTo(m_channel.fd(), len, &savedErrno);
+    if (nwrote >= 0) {
+      remaining = len - nwrote;
+      if (remaining == 0 && m_writeCompleteCallback) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->m_writeCompleteCallback(self); });
+      }
+    } else if (savedErrno != EWOULDBLOCK) {
+      LOG_SYSERR << "TCPConnection::sendPipeInLoop";
+      if (savedErrno == EPIPE || savedErrno == ECONNRESET) {
+        pipe->discard(len);
+        return;
+      }
+    }
+  }
+
+  if (remaining > 0) {
+    checkHighWaterMark(m_outputBuffer.readableBytes(), remaining);
+    m_outputBuffer.appendPipe(pipe, remaining);
+    if (!m_channel.isWriting()) {
+      m_channel.enableWriting();
+    }
+  }
+}
+
+void TCPConnection::sendFileInLoop(int fd, off_t offset, size_t length) {
+  m_loop->assertInLoopThread();
+  if (m_state == kDisconnected) {
+    LOG_WARN << "disconnected, give up sending file";
+    socket::close(fd);
+    return;
+  }
+  size_t remaining = length;
+  if (!m_channel.isWriting() && m_outputBuffer.empty() && length > 0) {
+    ssize_t nwrote = socket::sendfile(
+        m_channel.fd(), fd, &offset,
+        std::min(length, BufferChain::kFileChunkSize));
+    int savedErrno = nwrote == 0 ? EIO : errno; // 返回0说明文件比区域短
+    if (nwrote > 0) {
+      remaining = length - nwrote;
+      reportFileProgress(BufferChain::FileProgress{
+          static_cast<size_t>(nwrote), length});
+      if (remaining == 0 && m_writeCompleteCallback) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->m_writeCompleteCallback(self); });
+      }
+    } else if (savedErrno != EWOULDBLOCK) {
+      errno = savedErrno;
+      LOG_SYSERR << "TCPConnection::sendFileInLoop";
+      socket::close(fd);
+      // 对端关闭时会有关闭事件，其他错误(如文件读不出)要立即关闭连接
+      if (savedErrno != EPIPE && savedErrno != ECONNRESET) {
+        forceCloseInLoop();
+      }
+      return;
+    }
+  }
+
+  if (remaining > 0) {
+    checkHighWaterMark(m_outputBuffer.readableBytes(), remaining);
+    m_outputBuffer.appendFile(fd, offset, remaining, length);
+    if (!m_channel.isWriting()) {
+      m_channel.enableWriting();
+    }
+  } else {
+    socket::close(fd);
+  }
+}
+
+void TCPConnection::checkHighWaterMark(size_t oldLen, size_t remaining) {
+  if (oldLen + remaining >= m_highWaterMark && oldLen < m_highWaterMark &&
+      m_highWaterMarkCallback) {
+    m_aboveHighWaterMark = true;
+    auto self = shared_from_this();
+    size_t len = oldLen + remaining;
+    m_loop->queueInLoop(
+        [self, len]() { self->m_highWaterMarkCallback(self, len); });
+  }
+}
+
+void TCPConnection::checkLowWaterMark() {
+  if (m_aboveHighWaterMark &&
+      m_outputBuffer.readableBytes() <= m_lowWaterMark) {
+    m_aboveHighWaterMark = false;
+    if (m_lowWaterMarkCallback) {
+      auto self = shared_from_this();
+      m_loop->queueInLoop([self]() { self->m_lowWaterMarkCallback(self); });
+    }
+  }
+}
+
+void TCPConnection::reportFileProgress(
+    const BufferChain::FileProgress &progress) {
+  if (progress.total > 0 && m_fileProgressCallback) {
+    auto self = shared_from_this();
+    size_t sent = progress.sent;
+    size_t total = progress.total;
+    m_loop->queueInLoop([self, sent, total]() {
+      self->m_fileProgressCallback(self, sent, total);
+    });
+  }
+}
+
+void TCPConnection::shutdown() {
+  if (m_state == kConnected) {
+    setState(kDisconnecting);
+    auto self = shared_from_this();
+    m_loop->runInLoop([self]() { self->shutdownInLoop(); });
+  }
+}
+
+void TCPConnection::shutdownInLoop() {
+  m_loop->assertInLoopThread();
+  // 输出缓冲链中还有数据时，等handleWrite写完再关闭
+  if (!m_channel.isWriting()) {
+    m_socket.shutdownWrite();
+  }
+}
+
+void TCPConnection::forceClose() {
+  if (m_state == kConnected || m_state == kDisconnecting) {
+    setState(kDisconnecting);
+    auto self = shared_from_this();
+    m_loop->queueInLoop([self]() { self->forceCloseInLoop(); });
+  }
+}
+
+void TCPConnection::forceCloseInLoop() {
+  m_loop->assertInLoopThread();
+  if (m_state == kConnected || m_state == kDisconnecting) {
+    handleClose();
+  }
+}
+
+const char *TCPConnection::stateToString() const {
+  switch (m_state) {
+  case kDisconnected:
+    return "kDisconnected";
+  case kConnecting:
+    return "kConnecting";
+  case kConnected:
+    return "kConnected";
+  case kDisconnecting:
+    return "kDisconnecting";
+  default:
+    return "unknown state";
+  }
+}
+
+void TCPConnection::setTcpNoDelay(bool on) { m_socket.setNoDelay(on); }
+
+void TCPConnection::setEdgeTriggered() {
+  assert(m_state == kConnecting);
+  m_channel.setEdgeTriggered();
+}
+
+bool TCPConnection::isEdgeTriggered() const {
+  return m_channel.isEdgeTriggered();
+}
+
+void TCPConnection::setSpliceHeaderLength(size_t headerLength) {
+  m_loop->assertInLoopThread();
+  m_spliceHeaderLength = headerLength;
+  // splice需要就绪通知，数据不能先被poller收取到用户空间
+  if (headerLength > 0 && m_channel.completionRecv()) {
+    m_channel.setCompletionRecv(nullptr);
+  }
+}
+
+bool TCPConnection::setMirroredInputBuffer(size_t capacity) {
+  m_loop->assertInLoopThread();
+  return m_inputBuffer.makeMirrored(capacity);
+}
+
+void TCPConnection::spliceTo(const TcpConnectionPtr &dst, size_t len) {
+  m_loop->assertInLoopThread();
+  assert(m_spliceHeaderLength > 0 && m_spliceRemaining == 0);
+  size_t buffered = std::min(len, m_inputBuffer.readableBytes());
+  if (buffered > 0 && dst) {
+    dst->send(m_inputBuffer.peek(), static_cast<int>(buffered));
+  }
+  m_inputBuffer.retrieve(buffered);
+  m_spliceRemaining = len - buffered;
+  m_spliceDst = m_spliceRemaining > 0 ? dst : nullptr;
+}
+
+void TCPConnection::startRead() {
+  auto self = shared_from_this();
+  m_loop->runInLoop([self]() { self->startReadInLoop(); });
+}
+
+void TCPConnection::startReadInLoop() {
+  m_loop->assertInLoopThread();
+  if (m_splicePaused) {
+    // 管道腾出空间时由resumeSplice恢复读取
+    m_reading = true;
+    return;
+  }
+  if (!m_reading || !m_channel.isReading()) {
+    m_channel.enableReading();
+    m_reading = true;
+    // 边沿触发时，暂停期间到达的数据不会再产生事件，需要主动读一次；
+    // 完成模式下暂停期间收到的数据已经在m_inputBuffer中，需要交给回调
+    if ((m_channel.isEdgeTriggered() || m_channel.completionRecv()) &&
+        m_state != kDisconnected) {
+      auto self = shared_from_this();
+      m_loop->queueInLoop([self]() { self->resumeRead(); });
+    }
+  }
+}
+
+void TCPConnection::resumeRead() {
+  if (m_state != kDisconnected && m_reading) {
+    handleRead();
+  }
+}
+
+void TCPConnection::stopRead() {
+  auto self = shared_from_this();
+  m_loop->runInLoop([self]() { self->stopReadInLoop(); });
+}
+
+void TCPConnection::stopReadInLoop() {
+  m_loop->assertInLoopThread();
+  if (m_reading || m_channel.isReading()) {
+    m_channel.disableReading();
+    m_reading = false;
+  }
+}
+
+void TCPConnection::throttleRead() {
+  auto self = shared_from_this();
+  m_loop->queueInLoop([self]() {
+    if (self->m_readThrottles++ == 0 && !self->disconnected()) {
+      self->stopReadInLoop();
+    }
+  });
+}
+
+void TCPConnection::unthrottleRead() {
+  auto self = shared_from_this();
+  m_loop->queueInLoop([self]() {
+    assert(self->m_readThrottles > 0);
+    if (--self->m_readThrottles == 0 && !self->disconnected()) {
+      self->startReadInLoop();
+    }
+  });
+}
+
+void TCPConnection::waitForBufferMemory() {
+  m_loop->assertInLoopThread();
+  if (m_readThrottles++ == 0) {
+    stopReadInLoop();
+  }
+  std::weak_ptr<TCPConnection> weakSelf(shared_from_this());
+  m_loop->runAfter(kBufferRetryDelay, [weakSelf]() {
+    if (TcpConnectionPtr self = weakSelf.lock()) {
+      if (--self->m_readThrottles == 0 && !self->disconnected()) {
+        self->startReadInLoop();
+      }
+    }
+  });
+}
+
+void TCPConnection::setIdleTimeout(double seconds) {
+  if (m_state == kConnecting) {
+    m_idleTimeout = seconds;
+  } else {
+    auto self = shared_from_this();
+    m_loop->runInLoop(
+        [self, seconds]() { self->setIdleTimeoutInLoop(seconds); });
+  }
+}
+
+void TCPConnection::setIdleTimeoutInLoop(double seconds) {
+  m_loop->assertInLoopThread();
+  m_idleTimeout = seconds;
+  if (m_state != kConnected) {
+    return;
+  }
+  if (m_idleTimeout > 0.0) {
+    m_loop->timingWheel()->reschedule(&m_idleEntry, m_idleTimeout);
+  } else {
+    m_loop->timingWheel()->cancel(&m_idleEntry);
+  }
+}
+
+void TCPConnection::connectEstablished() {
+  m_loop->assertInLoopThread();
+  assert(m_state == kConnecting);
+  setState(kConnected);
+  m_channel.tie(shared_from_this());
+  m_channel.enableReading();
+  if (m_idleTimeout > 0.0) {
+    m_loop->timingWheel()->schedule(&m_idleEntry, m_idleTimeout);
+  }
+  if (m_connectionCallback) {
+    m_connectionCallback(shared_from_this());
+  }
+}
+
+void TCPConnection::connectDestroyed() {
+  m_loop->assertInLoopThread();
+  m_loop->timingWheel()->cancel(&m_idleEntry);
+  if (m_state == kConnected) {
+    setState(kDisconnected);
+    m_channel.disableAll();
+    if (m_connectionCallback) {
+      m_connectionCallback(shared_from_this());
+    }
+  }
+  m_channel.remove();
+}
+
+void TCPConnection::handleRead() {
+  m_loop->assertInLoopThread();
+  if (m_spliceHeaderLength > 0) {
+    handleSpliceRead();
+    return;
+  }
+  if (m_channel.completionRecv()) {
+    handleRecvCompletions();
+    return;
+  }
+  // 水平触发只读一次；边沿触发读到EAGAIN，或者回调中停止了读取
+  const bool edgeTriggered = m_channel.isEdgeTriggered();
+  for (int reads = 0;; ++reads) {
+    if (edgeTriggered && reads == kMaxReadsPerEvent) {
+      // 避免一个连接独占loop，剩下的数据放到下一轮读
+      auto self = shared_from_this();
+      m_loop->queueInLoop([self]() { self->resumeRead(); });
+      return;
+    }
+    int savedErrno = 0;
+    ssize_t n = m_inputBuffer.readFd(m_channel.fd(), &savedErrno);
+    if (n > 0) {
+      if (m_idleTimeout > 0.0) {
+        m_loop->timingWheel()->reschedule(&m_idleEntry, m_idleTimeout);
+      }
+      if (m_messageCallback) {
+        m_messageCallback(shared_from_this(), &m_inputBuffer);
+      } else {
+        m_inputBuffer.retrieveAll();
+      }
+    } else if (n == 0) {
+      handleClose();
+      return;
+    } else {
+      if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+        return;
+      }
+      if (savedErrno == ENOBUFS) {
+        waitForBufferMemory();
+        return;
+      }
+      errno = savedErrno;
+      LOG_SYSERR << "TCPConnection::handleRead";
+      handleError();
+      return;
+    }
+    if (!edgeTriggered || m_state == kDisconnected || !m_reading) {
+      return;
+    }
+  }
+}
+
+void TCPConnection::handleRecvCompletions() {
+  Channel::Completions *completions = m_channel.completions();
+  // 停止读取期间收到的数据留在m_inputBuffer中，startRead时再交给回调
+  if (m_state == kDisconnected || !m_reading) {
+    return;
+  }
+  if (completions->received > 0) {
+    completions->received = 0;
+    if (m_idleTimeout > 0.0) {
+      m_loop->timingWheel()->reschedule(&m_idleEntry, m_idleTimeout);
+    }
+    if (m_messageCallback) {
+      m_messageCallback(shared_from_this(), &m_inputBuffer);
+    } else {
+      m_inputBuffer.retrieveAll();
+    }
+  }
+  if (m_state == kDisconnected) {
+    return;
+  }
+  if (completions->eof) {
+    handleClose();
+  } else if (completions->error != 0) {
+    // 接收请求已经因错误结束，不会再有数据
+    errno = completions->error;
+    completions->error = 0;
+    LOG_SYSERR << "TCPConnection::handleRead";
+    handleError();
+    handleClose();
+  }
+}
+
+void TCPConnection::handleSpliceRead() {
+  const bool edgeTriggered = m_channel.isEdgeTriggered();
+  for (int reads = 0; !m_splicePaused; ++reads) {
+    if (reads == kMaxReadsPerEvent) {
+      // 水平触发时剩下的数据会再次产生事件
+      if (edgeTriggered) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->resumeRead(); });
+      }
+      return;
+    }
+    int savedErrno = 0;
+    ssize_t n = m_spliceRemaining > 0 ? spliceBody(&savedErrno)
+                                      : readSpliceHeader(&savedErrno);
+    if (n > 0) {
+      if (m_idleTimeout > 0.0) {
+        m_loop->timingWheel()->reschedule(&m_idleEntry, m_idleTimeout);
+      }
+    } else if (n == 0) {
+      handleClose();
+      return;
+    } else {
+      if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+        return;
+      }
+      errno = savedErrno;
+      LOG_SYSERR << "TCPConnection::handleSpliceRead";
+      handleError();
+      return;
+    }
+    if (m_state == kDisconnected || !m_reading) {
+      return;
+    }
+  }
+}
+
+ssize_t TCPConnection::readSpliceHeader(int *savedErrno) {
+  // 只读到报头为止，后面的报文体留在socket中等待splice
+  size_t readable = m_inputBuffer.readableBytes();
+  size_t need = readable < m_spliceHeaderLength
+                    ? m_spliceHeaderLength - readable
+                    : m_spliceHeaderLength;
+  m_inputBuffer.ensureWritableBytes(need);
+  ssize_t n = socket::read(m_channel.fd(), m_inputBuffer.beginWrite(), need);
+  if (n < 0) {
+    *savedErrno = errno;
+    return n;
+  }
+  m_inputBuffer.hasWritten(n);
+  if (m_inputBuffer.readableBytes() >= m_spliceHeaderLength) {
+    if (m_messageCallback) {
+      m_messageCallback(shared_from_this(), &m_inputBuffer);
+    } else {
+      m_inputBuffer.retrieveAll();
+    }
+  }
+  return n;
+}
+
+ssize_t TCPConnection::spliceBody(int *savedErrno) {
+  if (!m_spliceDst) {
+    return copyBody(savedErrno);
+  }
+  if (!m_splicePipe || m_splicePipeDst.lock() != m_spliceDst) {
+    // 旧管道中可能还有发给之前目的连接的数据，换一个新的管道
+    m_splicePipe = std::make_shared<SplicePipe>();
+    m_splicePipeDst = m_spliceDst;
+    std::weak_ptr<TCPConnection> weakSelf(shared_from_this());
+    EventLoop *loop = m_loop;
+    // 在目的连接的线程中回调，总是排队执行，避免在其写回调中重入
+    m_splicePipe->setWritableCallback([weakSelf, loop]() {
+      loop->queueInLoop([weakSelf]() {
+        if (TcpConnectionPtr self = weakSelf.lock()) {
+          self->resumeSplice();
+        }
+      });
+    });
+  }
+  if (!m_splicePipe->valid() || m_spliceDst->disconnected()) {
+    return copyBody(savedErrno);
+  }
+
+  const int fd = m_channel.fd();
+  ssize_t n = m_splicePipe->spliceFrom(fd, m_spliceRemaining, savedErrno);
+  if (n < 0 && *savedErrno == EAGAIN && socket::bytesAvailable(fd) > 0) {
+    // socket中有数据却移动不了，说明管道满了；先登记等待再重试一次，
+    // 防止目的连接恰好在两者之间取走数据而错过唤醒
+    m_splicePipe->setWriterWaiting(true);
+    n = m_splicePipe->spliceFrom(fd, m_spliceRemaining, savedErrno);
+    if (n < 0 && *savedErrno == EAGAIN) {
+      m_splicePaused = true;
+      m_channel.disableReading();
+      return n;
+    }
+    m_splicePipe->setWriterWaiting(false);
+  }
+  if (n > 0) {
+    m_spliceRemaining -= n;
+    m_spliceDst->sendPipe(m_splicePipe, n);
+    if (m_spliceRemaining == 0) {
+      m_spliceDst.reset();
+    }
+  }
+  return n;
+}
+
+ssize_t TCPConnection::copyBody(int *savedErrno) {
+  size_t len = std::min(m_spliceRemaining, kSpliceCopySize);
+  m_inputBuffer.ensureWritableBytes(len);
+  char *data = m_inputBuffer.beginWrite();
+  ssize_t n = socket::read(m_channel.fd(), data, len);
+  if (n < 0) {
+    *savedErrno = errno;
+    return n;
+  }
+  // 没有目的连接或者目的连接已经关闭时相当于丢弃
+  if (m_spliceDst) {
+    m_spliceDst->send(data, static_cast<int>(n));
+  }
+  m_spliceRemaining -= n;
+  if (m_spliceRemaining == 0) {
+    m_spliceDst.reset();
+  }
+  return n;
+}
+
+void TCPConnection::resumeSplice() {
+  if (!m_splicePaused) {
+    return;
+  }
+  m_splicePaused = false;
+  if (m_state != kDisconnected && m_reading) {
+    m_channel.enableReading();
+    handleRead();
+  }
+}
+
+void TCPConnection::handleWrite() {
+  m_loop->assertInLoopThread();
+  if (!m_channel.isWriting()) {
+    LOG_TRACE << "Connection fd = " << m_channel.fd()
+              << " is down, no more writing";
+    return;
+  }
+  int savedErrno = 0;
+  BufferChain::FileProgress progress;
+  ssize_t n = m_outputBuffer.writeFd(m_channel.fd(), &savedErrno, &progress);
+  reportFileProgress(progress);
+  size_t written = n > 0 ? static_cast<size_t>(n) : 0;
+  // 边沿触发时一直写到EAGAIN或者写完
+  while (n > 0 && m_channel.isEdgeTriggered() && !m_outputBuffer.empty()) {
+    n = m_outputBuffer.writeFd(m_channel.fd(), &savedErrno, &progress);
+    reportFileProgress(progress);
+    if (n > 0) {
+      written += static_cast<size_t>(n);
+    }
+  }
+  // 边沿触发时最后一次写通常是EAGAIN，前面写出的字节同样要检查低水位
+  if (written > 0) {
+    checkLowWaterMark();
+  }
+  if (n > 0) {
+    if (m_outputBuffer.empty()) {
+      m_channel.disableWriting();
+      if (m_writeCompleteCallback) {
+        auto self = shared_from_this();
+        m_loop->queueInLoop([self]() { self->m_writeCompleteCallback(self); });
+      }
+      if (m_state == kDisconnecting) {
+        shutdownInLoop();
+      }
+    }
+  } else if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+    errno = savedErrno;
+    LOG_SYSERR << "TCPConnection::handleWrite";
+    if (savedErrno != EINTR) {
+      // 输出缓冲链卡在首段(如文件段读不出)，后面的数据不能再按顺序送达，
+      // 也不会有别的事件来关闭连接
+      forceCloseInLoop();
+    }
+  }
+}
+
+void TCPConnection::handleClose() {
+  m_loop->assertInLoopThread();
+  assert(m_state == kConnected || m_state == kDisconnecting);
+  setState(kDisconnected);
+  m_channel.disableAll();
+  m_loop->timingWheel()->cancel(&m_idleEntry);
+  // 输出链中的管道段要取走，源连接才能继续使用管道
+  m_outputBuffer.retrieveAll();
+  m_spliceDst.reset();
+  m_spliceRemaining = 0;
+
+  TcpConnectionPtr guard(shared_from_this());
+  if (m_connectionCallback) {
+    m_connectionCallback(guard);
+  }
+  // 必须放在最后调用，TcpServer会在其中移除该连接
+  if (m_closeCallback) {
+    m_closeCallback(guard);
+  }
+}
+
+void TCPConnection::handleError() {
+  int err = socket::getSocketError(m_channel.fd());
+  LOG_ERROR << "TCPConnection::handleError [" << m_name
+            << "] - SO_ERROR = " << err << " " << strerror_tl(err);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file TcpClient.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief TCP客户端的实现
+ * @version 0.1
+ * @date 2024-08-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/TcpClient.h"
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/SocketOps.h"
+#include <cassert>
+using namespace neonet;
+
+TcpClient::TcpClient(EventLoop *loop, const NetAddress &serverAddr,
+                     const std::string &name)
+    : m_loop(loop), m_connector(new Connector(loop, serverAddr)),
+      m_name(name), m_connectionCallback(defaultConnectionCallback),
+      m_messageCallback(defaultMessageCallback) {
+  m_connector->setNewConnectionCallback(
+      [this](int sockfd) { newConnection(sockfd); });
+}
+
+TcpClient::~TcpClient() {
+  TcpConnectionPtr conn;
+  bool unique = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unique = m_connection.use_count() == 1;
+    conn = m_connection;
+  }
+  if (conn) {
+    assert(m_loop == conn->loop());
+    // 连接可能比客户端活得久，关闭回调不能再访问this
+    EventLoop *loop = m_loop;
+    m_loop->runInLoop([loop, conn]() {
+      conn->setCloseCallback([loop](const TcpConnectionPtr &c) {
+        loop->queueInLoop([c]() { c->connectDestroyed(); });
+      });
+    });
+    if (unique) {
+      conn->forceClose();
+    }
+  } else {
+    m_connector->stop();
+  }
+}
+
+void TcpClient::connect() {
+  m_connect = true;
+  m_connector->start();
+}
+
+void TcpClient::disconnect() {
+  m_connect = false;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_connection) {
+    m_connection->shutdown();
+  }
+}
+
+void TcpClient::stop() {
+  m_connect = false;
+  m_connector->stop();
+}
+
+void TcpClient::newConnection(int sockfd) {
+  m_loop->assertInLoopThread();
+  struct sockaddr peer = socket::getPeerAddr(sockfd);
+  struct sockaddr local = socket::getLocalAddr(sockfd);
+  NetAddress peerAddr(*socket::sockaddr_in_cast(&peer));
+  NetAddress localAddr(*socket::sockaddr_in_cast(&local));
+  char buf[64];
+  socket::toIpPort(buf, sizeof buf, &peer);
+  std::string connName =
+      m_name + ":" + buf + "#" + std::to_string(m_nextConnId);
+  ++m_nextConnId;
+
+  TcpConnectionPtr conn = std::allocate_shared<TCPConnection>(
+      SlabAllocator<TCPConnection>(m_loop->connectionSlab()), m_loop,
+      connName, sockfd, localAddr, peerAddr);
+  conn->setConnectionCallback(m_connectionCallback);
+  conn->setMessageCallback(m_messageCallback);
+  conn->setWriteCompleteCallback(m_writeCompleteCallback);
+  if (m_edgeTriggered) {
+    conn->setEdgeTriggered();
+  }
+  conn->setCloseCallback(
+      [this](const TcpConnectionPtr &c) { removeConnection(c); });
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connection = conn;
+  }
+  conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn) {
+  m_loop->assertInLoopThread();
+  assert(m_loop == conn->loop());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(m_connection == conn);
+    m_connection.reset();
+  }
+  // 必须用queueInLoop，当前还在该连接Channel的handleEvent中
+  m_loop->queueInLoop([conn]() { conn->connectDestroyed(); });
+  if (m_retry && m_connect) {
+    LOG_INFO << "TcpClient::connect[" << m_name << "] - Reconnecting to "
+             << m_connector->serverAddress().getIp() << ":"
+             << m_connector->serverAddress().getPort();
+    m_connector->restart();
+  }
+}
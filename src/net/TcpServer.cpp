@@ -0,0 +1,189 @@
+/**
+ * @file TcpServer.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/TcpServer.h"
+#include "net/Acceptor.h"
+#include "net/EventLoop.h"
+#include "net/SocketOps.h"
+#include <cassert>
+#include <future>
+using namespace neonet;
+
+namespace {
+std::string toIpPort(const NetAddress &addr) {
+  char buf[64] = "";
+  socket::toIpPort(buf, sizeof buf, socket::sockaddr_cast(&addr.getAddr()));
+  return buf;
+}
+} // namespace
+
+TcpServer::Shard::Shard(EventLoop *ownerLoop, int shardIndex)
+    : loop(ownerLoop), index(shardIndex) {}
+
+TcpServer::TcpServer(EventLoop *loop, const NetAddress &listenAddr,
+                     const std::string &name, Option option)
+    : m_loop(loop), m_listenAddr(listenAddr), m_ipPort(toIpPort(listenAddr)),
+      m_name(name), m_option(option),
+      m_threadPool(new EventLoopThreadPool(loop, name)),
+      m_connectionCallback(defaultConnectionCallback),
+      m_messageCallback(defaultMessageCallback) {
+  if (m_option == kSingleAcceptor) {
+    // 提前绑定端口，kReusePort的Acceptor要等工作loop启动后才能创建
+    std::unique_ptr<Shard> shard(new Shard(m_loop, 0));
+    Shard *s = shard.get();
+    s->acceptor.reset(new Acceptor(m_loop, m_listenAddr));
+    s->acceptor->setNewConnectionCallback(
+        [this, s](int sockfd, const NetAddress &peerAddr) {
+          newConnection(s, sockfd, peerAddr);
+        });
+    m_shards.push_back(std::move(shard));
+  }
+}
+
+TcpServer::~TcpServer() {
+  m_loop->assertInLoopThread();
+  for (auto &shard : m_shards) {
+    Shard *s = shard.get();
+    if (s->loop->isInLoopThread()) {
+      destroyShard(s);
+    } else {
+      // Acceptor的Channel只能在所属loop中移除，等它完成后再释放shard
+      std::promise<void> done;
+      s->loop->runInLoop([s, &done]() {
+        destroyShard(s);
+        done.set_value();
+      });
+      done.get_future().wait();
+    }
+  }
+}
+
+void TcpServer::destroyShard(Shard *shard) {
+  shard->loop->assertInLoopThread();
+  shard->acceptor.reset();
+  for (auto &item : shard->connections) {
+    TcpConnectionPtr conn(item.second);
+    item.second.reset();
+    conn->loop()->runInLoop([conn]() { conn->connectDestroyed(); });
+  }
+  shard->connections.clear();
+}
+
+void TcpServer::setThreadNum(int numThreads) {
+  assert(0 <= numThreads);
+  m_threadPool->setThreadNum(numThreads);
+}
+
+void TcpServer::start() {
+  if (m_started.exchange(true)) {
+    return;
+  }
+  m_threadPool->start(m_threadInitCallback);
+  if (m_option == kSingleAcceptor) {
+    // 连接在处理它的工作loop中创建和销毁，各自使用所在loop的slab
+    for (EventLoop *ioLoop : m_threadPool->getAllLoops()) {
+      m_shards.emplace_back(
+          new Shard(ioLoop, static_cast<int>(m_shards.size())));
+      m_connectionShards.push_back(m_shards.back().get());
+    }
+  } else {
+    // 每个工作loop一个Acceptor，bind时已经设置了SO_REUSEPORT
+    for (EventLoop *ioLoop : m_threadPool->getAllLoops()) {
+      std::unique_ptr<Shard> shard(
+          new Shard(ioLoop, static_cast<int>(m_shards.size())));
+      Shard *s = shard.get();
+      s->acceptor.reset(new Acceptor(ioLoop, m_listenAddr));
+      s->acceptor->setNewConnectionCallback(
+          [this, s](int sockfd, const NetAddress &peerAddr) {
+            newConnection(s, sockfd, peerAddr);
+          });
+      m_connectionShards.push_back(s);
+      m_shards.push_back(std::move(shard));
+    }
+  }
+  for (auto &shard : m_shards) {
+    Shard *s = shard.get();
+    if (!s->acceptor) {
+      continue;
+    }
+    assert(!s->acceptor->listenning());
+    if (m_edgeTriggered) {
+      s->acceptor->setEdgeTriggered();
+    }
+    s->loop->runInLoop([s]() { s->acceptor->listen(); });
+  }
+}
+
+void TcpServer::newConnection(Shard *shard, int sockfd,
+                              const NetAddress &peerAddr) {
+  shard->loop->assertInLoopThread();
+  // kSingleAcceptor时轮询选择一个工作loop；kReusePort时就在接受它的loop上处理
+  Shard *owner = shard;
+  if (m_option == kSingleAcceptor) {
+    owner = m_connectionShards[m_nextShard];
+    m_nextShard = (m_nextShard + 1) % m_connectionShards.size();
+  }
+  int acceptorIndex = shard->index;
+  int connId = shard->nextConnId++;
+
+  if (owner->loop->isInLoopThread()) {
+    createConnection(owner, sockfd, acceptorIndex, connId, peerAddr);
+  } else {
+    // 析构时先在m_loop中销毁Acceptor shard，再依次等待各工作loop销毁
+    // 自己的shard，此前排队的创建任务一定已经执行
+    owner->loop->queueInLoop(
+        [this, owner, sockfd, acceptorIndex, connId, peerAddr]() {
+          createConnection(owner, sockfd, acceptorIndex, connId, peerAddr);
+        });
+  }
+}
+
+void TcpServer::createConnection(Shard *owner, int sockfd, int acceptorIndex,
+                                 int connId, const NetAddress &peerAddr) {
+  owner->loop->assertInLoopThread();
+  std::string name = m_name + "-" + m_ipPort + "#" +
+                     std::to_string(acceptorIndex) + "-" +
+                     std::to_string(connId);
+  const std::shared_ptr<SlabPool> &slab = owner->loop->connectionSlab();
+  assert(slab->isOwnerThread());
+  struct sockaddr local = socket::getLocalAddr(sockfd);
+  NetAddress localAddr(*socket::sockaddr_in_cast(&local));
+  TcpConnectionPtr conn = std::allocate_shared<TCPConnection>(
+      SlabAllocator<TCPConnection>(slab), owner->loop, name, sockfd,
+      localAddr, peerAddr);
+  owner->connections[name] = conn;
+  conn->setConnectionCallback(m_connectionCallback);
+  conn->setMessageCallback(m_messageCallback);
+  conn->setWriteCompleteCallback(m_writeCompleteCallback);
+  conn->setIdleTimeout(m_idleTimeout);
+  if (m_edgeTriggered) {
+    conn->setEdgeTriggered();
+  }
+  conn->setCloseCallback([this, owner](const TcpConnectionPtr &c) {
+    removeConnection(owner, c);
+  });
+  conn->connectEstablished();
+}
+
+void TcpServer::removeConnection(Shard *shard, const TcpConnectionPtr &conn) {
+  shard->loop->runInLoop(
+      [this, shard, conn]() { removeConnectionInLoop(shard, conn); });
+}
+
+void TcpServer::removeConnectionInLoop(Shard *shard,
+                                       const TcpConnectionPtr &conn) {
+  shard->loop->assertInLoopThread();
+  size_t n = shard->connections.erase(conn->name());
+  assert(n == 1);
+  (void)n;
+  // 必须用queueInLoop，当前可能还在该连接Channel的handleEvent中
+  EventLoop *ioLoop = conn->loop();
+  ioLoop->queueInLoop([conn]() { conn->connectDestroyed(); });
+}
@@ -0,0 +1,202 @@
+/**
+ * @file TimerQueue.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 定时器队列的实现
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/TimerQueue.h"
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/Timer.h"
+#include "tools/memtools.h"
+#include <cassert>
+#include <iterator>
+#include <sys/timerfd.h>
+#include <unistd.h>
+using namespace neonet;
+
+namespace {
+int createTimerfd() {
+  int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timerfd < 0) {
+    LOG_SYSFATAL << "Failed in timerfd_create";
+  }
+  return timerfd;
+}
+
+/**
+ * @brief 计算从现在到when的时间间隔，最少100微秒
+ *
+ * @param when
+ * @return struct timespec
+ */
+struct timespec howMuchTimeFromNow(Timestamp when) {
+  int64_t microseconds =
+      when.microSeconds() - Timestamp::now().microSeconds();
+  if (microseconds < 100) {
+    microseconds = 100;
+  }
+  struct timespec ts;
+  ts.tv_sec =
+      static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+  ts.tv_nsec = static_cast<long>(
+      (microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+  return ts;
+}
+
+void readTimerfd(int timerfd) {
+  uint64_t howmany;
+  ssize_t n = ::read(timerfd, &howmany, sizeof howmany);
+  if (n != sizeof howmany) {
+    LOG_ERROR << "TimerQueue::handleRead() reads " << n
+              << " bytes instead of 8";
+  }
+}
+
+/**
+ * @brief 将timerfd的到期时间设置为expiration
+ *
+ * @param timerfd
+ * @param expiration
+ */
+void resetTimerfd(int timerfd, Timestamp expiration) {
+  struct itimerspec newValue;
+  struct itimerspec oldValue;
+  memZero(&newValue, sizeof newValue);
+  memZero(&oldValue, sizeof oldValue);
+  newValue.it_value = howMuchTimeFromNow(expiration);
+  if (::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0) {
+    LOG_SYSERR << "timerfd_settime()";
+  }
+}
+} // namespace
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : m_loop(loop), m_timerfd(createTimerfd()),
+      m_timerfdChannel(loop, m_timerfd) {
+  m_timerfdChannel.setReadCallback([this]() { handleRead(); });
+  // 一直监听timerfd的读事件，通过timerfd_settime来启停
+  m_timerfdChannel.enableReading();
+}
+
+TimerQueue::~TimerQueue() {
+  m_timerfdChannel.disableAll();
+  m_timerfdChannel.remove();
+  ::close(m_timerfd);
+  for (const Entry &timer : m_timers) {
+    delete timer.second;
+  }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when,
+                             double interval) {
+  Timer *timer = new Timer(std::move(cb), when, interval);
+  m_loop->runInLoop([this, timer]() { addTimerInLoop(timer); });
+  return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId) {
+  m_loop->runInLoop([this, timerId]() { cancelInLoop(timerId); });
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer) {
+  m_loop->assertInLoopThread();
+  bool earliestChanged = insert(timer);
+  if (earliestChanged) {
+    resetTimerfd(m_timerfd, timer->expiration());
+  }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId) {
+  m_loop->assertInLoopThread();
+  assert(m_timers.size() == m_activeTimers.size());
+  ActiveTimer timer(timerId.m_timer, timerId.m_sequence);
+  auto it = m_activeTimers.find(timer);
+  if (it != m_activeTimers.end()) {
+    size_t n = m_timers.erase(Entry(it->first->expiration(), it->first));
+    assert(n == 1);
+    (void)n;
+    delete it->first;
+    m_activeTimers.erase(it);
+  } else if (m_callingExpiredTimers) {
+    // 定时器正在执行(例如在自己的回调中取消自己)，reset时不再重新插入
+    m_cancelingTimers.insert(timer);
+  }
+  assert(m_timers.size() == m_activeTimers.size());
+}
+
+void TimerQueue::handleRead() {
+  m_loop->assertInLoopThread();
+  Timestamp now(Timestamp::now());
+  readTimerfd(m_timerfd);
+
+  std::vector<Entry> expired = getExpired(now);
+
+  m_callingExpiredTimers = true;
+  m_cancelingTimers.clear();
+  for (const Entry &it : expired) {
+    it.second->run();
+  }
+  m_callingExpiredTimers = false;
+
+  reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
+  assert(m_timers.size() == m_activeTimers.size());
+  std::vector<Entry> expired;
+  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+  // 第一个未到期的定时器
+  auto end = m_timers.lower_bound(sentry);
+  assert(end == m_timers.end() || now < end->first);
+  std::copy(m_timers.begin(), end, std::back_inserter(expired));
+  m_timers.erase(m_timers.begin(), end);
+
+  for (const Entry &it : expired) {
+    ActiveTimer timer(it.second, it.second->sequence());
+    size_t n = m_activeTimers.erase(timer);
+    assert(n == 1);
+    (void)n;
+  }
+  assert(m_timers.size() == m_activeTimers.size());
+  return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now) {
+  for (const Entry &it : expired) {
+    ActiveTimer timer(it.second, it.second->sequence());
+    if (it.second->repeat() &&
+        m_cancelingTimers.find(timer) == m_cancelingTimers.end()) {
+      it.second->restart(now);
+      insert(it.second);
+    } else {
+      delete it.second;
+    }
+  }
+
+  if (!m_timers.empty()) {
+    Timestamp nextExpire = m_timers.begin()->second->expiration();
+    if (nextExpire.valid()) {
+      resetTimerfd(m_timerfd, nextExpire);
+    }
+  }
+}
+
+bool TimerQueue::insert(Timer *timer) {
+  m_loop->assertInLoopThread();
+  assert(m_timers.size() == m_activeTimers.size());
+  bool earliestChanged = false;
+  Timestamp when = timer->expiration();
+  auto it = m_timers.begin();
+  if (it == m_timers.end() || when < it->first) {
+    earliestChanged = true;
+  }
+  m_timers.insert(Entry(when, timer));
+  m_activeTimers.insert(ActiveTimer(timer, timer->sequence()));
+  assert(m_timers.size() == m_activeTimers.size());
+  return earliestChanged;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file TimingWheel.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 分层时间轮的实现
+ * @version 0.1
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "net/TimingWheel.h"
+#include "net/EventLoop.h"
+#include <cmath>
+using namespace neonet;
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds)
+    : m_loop(loop), m_tickSeconds(tickSeconds), m_start(Timestamp::now()) {
+  assert(m_tickSeconds > 0.0);
+  for (auto &level : m_wheel) {
+    for (Node &head : level) {
+      head.prev = head.next = &head;
+    }
+  }
+}
+
+TimingWheel::~TimingWheel() {
+  // 剩余的Entry由各自的持有者负责，这里只把它们摘下来
+  for (auto &level : m_wheel) {
+    for (Node &head : level) {
+      while (head.next != &head) {
+        unlink(static_cast<Entry *>(head.next));
+      }
+    }
+  }
+  if (m_ticking) {
+    m_loop->cancel(m_tickTimer);
+  }
+}
+
+void TimingWheel::schedule(Entry *entry, double delay) {
+  m_loop->assertInLoopThread();
+  assert(!entry->linked());
+  if (!m_ticking) {
+    startTicking();
+  }
+  entry->m_deadline = m_current + toTicks(delay);
+  entry->m_expire = entry->m_deadline;
+  link(entry);
+  ++m_size;
+}
+
+void TimingWheel::reschedule(Entry *entry, double delay) {
+  m_loop->assertInLoopThread();
+  if (!entry->linked()) {
+    schedule(entry, delay);
+    return;
+  }
+  uint64_t deadline = m_current + toTicks(delay);
+  if (deadline >= entry->m_expire) {
+    // 延后：到达原来的槽时再按新的deadline重新挂入
+    entry->m_deadline = deadline;
+  } else {
+    unlink(entry);
+    entry->m_deadline = deadline;
+    entry->m_expire = deadline;
+    link(entry);
+  }
+}
+
+void TimingWheel::cancel(Entry *entry) {
+  m_loop->assertInLoopThread();
+  if (entry->linked()) {
+    unlink(entry);
+    --m_size;
+  }
+}
+
+void TimingWheel::onTick() {
+  uint64_t target = targetTick();
+  while (m_size > 0 && m_current <= target) {
+    advance();
+  }
+  if (m_size == 0) {
+    // 没有Entry时停止周期定时器，下一次schedule时再启动
+    m_current = target + 1;
+    m_loop->cancel(m_tickTimer);
+    m_ticking = false;
+  }
+}
+
+void TimingWheel::advance() {
+  int index = static_cast<int>(m_current & (kSlots - 1));
+  // 第0层转完一圈，从上层依次取下一个槽的项挂到下层
+  if (index == 0) {
+    for (int level = 1; level < kLevels; ++level) {
+      if (cascade(level) != 0) {
+        break;
+      }
+    }
+  }
+  Node expired;
+  expired.prev = expired.next = &expired;
+  splice(&m_wheel[0][index], &expired);
+  const uint64_t now = m_current++;
+
+  while (expired.next != &expired) {
+    Entry *entry = static_cast<Entry *>(expired.next);
+    unlink(entry);
+    if (entry->m_deadline > now) {
+      entry->m_expire = entry->m_deadline;
+      link(entry);
+    } else {
+      --m_size;
+      if (entry->m_callback) {
+        // 回调中可能重新调度或销毁entry，之后不能再访问它
+        entry->m_callback();
+      }
+    }
+  }
+}
+
+int TimingWheel::cascade(int level) {
+  int index =
+      static_cast<int>((m_current >> (level * kLevelBits)) & (kSlots - 1));
+  Node moving;
+  moving.prev = moving.next = &moving;
+  splice(&m_wheel[level][index], &moving);
+  while (moving.next != &moving) {
+    Entry *entry = static_cast<Entry *>(moving.next);
+    unlink(entry);
+    entry->m_expire = entry->m_deadline;
+    link(entry);
+  }
+  return index;
+}
+
+void TimingWheel::link(Entry *entry) {
+  uint64_t expire = entry->m_expire;
+  if (expire < m_current) {
+    expire = m_current;
+  }
+  uint64_t delta = expire - m_current;
+  if (delta > kMaxTicks) {
+    delta = kMaxTicks;
+    expire = m_current + delta;
+  }
+  entry->m_expire = expire;
+  int level = 0;
+  while (level < kLevels - 1 &&
+         delta >= (uint64_t{1} << ((level + 1) * kLevelBits))) {
+    ++level;
+  }
+  int index =
+      static_cast<int>((expire >> (level * kLevelBits)) & (kSlots - 1));
+  pushBack(&m_wheel[level][index], entry);
+}
+
+void TimingWheel::unlink(Entry *entry) {
+  Node *node = entry;
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = node->next = nullptr;
+}
+
+void TimingWheel::pushBack(Node *head, Node *node) {
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+}
+
+void TimingWheel::splice(Node *head, Node *out) {
+  if (head->next == head) {
+    return;
+  }
+  out->next = head->next;
+  out->prev = head->prev;
+  out->next->prev = out;
+  out->prev->next = out;
+  head->prev = head->next = head;
+}
+
+uint64_t TimingWheel::toTicks(double delay) const {
+  double ticks = std::ceil(delay / m_tickSeconds);
+  if (ticks < 1.0) {
+    return 1;
+  }
+  if (ticks > static_cast<double>(kMaxTicks)) {
+    return kMaxTicks;
+  }
+  return static_cast<uint64_t>(ticks);
+}
+
+uint64_t TimingWheel::targetTick() const {
+  double elapsed = Timestamp::timeDifference(Timestamp::now(), m_start);
+  return static_cast<uint64_t>(elapsed / m_tickSeconds);
+}
+
+void TimingWheel::startTicking() {
+  assert(m_size == 0);
+  // 空闲期间没有推进，直接跳到当前时间对应的tick
+  uint64_t target = targetTick();
+  if (m_current < target) {
+    m_current = target;
+  }
+  m_ticking = true;
+  m_tickTimer = m_loop->runEvery(m_tickSeconds, [this]() { onTick(); });
+}
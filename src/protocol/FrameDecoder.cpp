@@ -0,0 +1,75 @@
+/**
+ * @file FrameDecoder.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 分帧解码器的实现
+ * @version 0.1
+ * @date 2024-08-05
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "protocol/FrameDecoder.h"
+#include "base/Logging.h"
+#include "net/Buffer.h"
+#include "net/TCPConnection.h"
+#include "tools/Bytetransform.h"
+#include <cstring>
+using namespace neonet;
+
+namespace {
+void defaultErrorCallback(const TcpConnectionPtr &conn, uint32_t length) {
+  LOG_WARN << "FrameDecoder: frame of " << length << " bytes from "
+           << conn->name() << " exceeds the limit, closing";
+  conn->forceClose();
+}
+} // namespace
+
+FrameDecoder::FrameDecoder(const FramesCallback &cb, uint32_t maxLength)
+    : m_framesCallback(cb), m_errorCallback(defaultErrorCallback),
+      m_maxLength(maxLength) {}
+
+neonet::Header FrameDecoder::peekHeader(const char *data) {
+  neonet::Header header;
+  ::memcpy(&header, data, kHeaderSize);
+  header.cmd = socket::networkToHost32(header.cmd);
+  header.length = socket::networkToHost32(header.length);
+  return header;
+}
+
+size_t FrameDecoder::decode(const char *data, size_t len,
+                            std::vector<Frame> *frames,
+                            uint32_t *badLength) const {
+  size_t offset = 0;
+  while (len - offset >= kHeaderSize) {
+    neonet::Header header = peekHeader(data + offset);
+    if (header.length > m_maxLength) {
+      *badLength = header.length;
+      break;
+    }
+    if (len - offset - kHeaderSize < header.length) {
+      break;
+    }
+    frames->push_back(
+        Frame{header.cmd, header.length, data + offset + kHeaderSize});
+    offset += kHeaderSize + header.length;
+  }
+  return offset;
+}
+
+void FrameDecoder::onMessage(const TcpConnectionPtr &conn,
+                             Buffer *buf) const {
+  // 每个线程复用一个视图数组，解码不分配内存
+  thread_local std::vector<Frame> frames;
+  frames.clear();
+  uint32_t badLength = 0;
+  size_t bytes = decode(buf->peek(), buf->readableBytes(), &frames,
+                        &badLength);
+  if (!frames.empty()) {
+    m_framesCallback(conn, FrameBatch(frames, buf->peek(), bytes));
+    buf->retrieve(bytes);
+  }
+  if (badLength > 0 && m_errorCallback) {
+    m_errorCallback(conn, badLength);
+    buf->retrieveAll();
+  }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file Benchmark.h
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 微基准测试的计时框架，不依赖第三方库，结果以JSON输出到stdout
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * 每个基准是一个body(iterations)，body必须恰好完成iterations次操作。
+ * 先从1次开始按耗时放大次数，直到单次运行不少于--min-time秒，
+ * 再以该次数重复--repetitions次，报告每次操作耗时的中位数、最小值和最大值。
+ * 命令行参数：
+ * - --filter=子串   只运行名字包含子串的基准
+ * - --min-time=秒   单次运行的最短时间，默认0.2
+ * - --repetitions=n 重复次数，默认3
+ * 进度输出到stderr；注意Debug构建(-O0)的数字只适合相对比较
+ *
+ */
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+namespace neonet::bench {
+/**
+ * @brief 阻止编译器优化掉对value的计算
+ *
+ */
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Runner {
+public:
+  using Body = std::function<void(uint64_t iterations)>;
+
+  Runner(int argc, char *argv[]) : m_executable(argv[0]) {
+    for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (::strncmp(arg, "--filter=", 9) == 0) {
+        m_filter = arg + 9;
+      } else if (::strncmp(arg, "--min-time=", 11) == 0) {
+        m_minTime = std::atof(arg + 11);
+      } else if (::strncmp(arg, "--repetitions=", 14) == 0) {
+        m_repetitions = std::max(1, std::atoi(arg + 14));
+      } else {
+        ::fprintf(stderr,
+                  "Usage: %s [--filter=substr] [--min-time=seconds] "
+                  "[--repetitions=n]\n",
+                  argv[0]);
+        std::exit(arg[2] == 'h' ? 0 : 1);
+      }
+    }
+  }
+  // noncopy
+  Runner(const Runner &) = delete;
+  Runner &operator=(const Runner &) = delete;
+
+  /**
+   * @brief 运行一个基准
+   *
+   * @param name 名字，约定为"模块/操作/参数"
+   * @param body
+   * @param bytesPerOp 每次操作处理的字节数，非0时额外报告字节吞吐量
+   */
+  void run(const std::string &name, const Body &body, uint64_t bytesPerOp = 0) {
+    if (!m_filter.empty() && name.find(m_filter) == std::string::npos) {
+      return;
+    }
+    ::fprintf(stderr, "%-48s", name.c_str());
+    uint64_t iterations = 1;
+    double elapsed = timeBody(body, iterations);
+    while (elapsed < m_minTime && iterations < kMaxIterations) {
+      // 按耗时估计达到min-time所需的次数，每次最多放大10倍
+      double scale = elapsed > 0 ? m_minTime * 1.4 / elapsed : 10.0;
+      scale = std::min(10.0, std::max(2.0, scale));
+      iterations = std::min(
+          kMaxIterations, static_cast<uint64_t>(iterations * scale));
+      elapsed = timeBody(body, iterations);
+    }
+    std::vector<double> samples; // 每次操作的纳秒数
+    samples.push_back(elapsed * 1e9 / iterations);
+    for (int i = 1; i < m_repetitions; ++i) {
+      samples.push_back(timeBody(body, iterations) * 1e9 / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = samples[samples.size() / 2];
+    result.minNsPerOp = samples.front();
+    result.maxNsPerOp = samples.back();
+    result.bytesPerOp = bytesPerOp;
+    m_results.push_back(result);
+    ::fprintf(stderr, "%12.1f ns/op %14.0f ops/s\n", result.nsPerOp,
+              1e9 / result.nsPerOp);
+  }
+
+  /**
+   * @brief 以JSON输出全部结果
+   *
+   */
+  void report() const {
+    char date[64];
+    time_t now = ::time(nullptr);
+    struct tm tm;
+    ::gmtime_r(&now, &tm);
+    ::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    ::printf("{\n  \"context\": {\n");
+    ::printf("    \"executable\": \"%s\",\n", m_executable.c_str());
+    ::printf("    \"date\": \"%s\",\n", date);
+    ::printf("    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef __DEBUG__
+    ::printf("    \"build_type\": \"debug\",\n");
+#else
+    ::printf("    \"build_type\": \"release\",\n");
+#endif
+    ::printf("    \"min_time\": %g,\n", m_minTime);
+    ::printf("    \"repetitions\": %d\n  },\n", m_repetitions);
+    ::printf("  \"benchmarks\": [");
+    for (size_t i = 0; i < m_results.size(); ++i) {
+      const Result &r = m_results[i];
+      ::printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+               "\"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, "
+               "\"max_ns_per_op\": %.2f, \"ops_per_second\": %.1f",
+               i == 0 ? "" : ",", r.name.c_str(),
+               static_cast<unsigned long long>(r.iterations), r.nsPerOp,
+               r.minNsPerOp, r.maxNsPerOp, 1e9 / r.nsPerOp);
+      if (r.bytesPerOp != 0) {
+        ::printf(", \"bytes_per_second\": %.1f",
+                 r.bytesPerOp * 1e9 / r.nsPerOp);
+      }
+      ::printf("}");
+    }
+    ::printf("\n  ]\n}\n");
+  }
+
+private:
+  struct Result {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double minNsPerOp;
+    double maxNsPerOp;
+    uint64_t bytesPerOp;
+  };
+
+  static double timeBody(const Body &body, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  }
+
+  inline static constexpr const uint64_t kMaxIterations{1000ULL * 1000 * 1000};
+
+  std::string m_executable;
+  std::string m_filter;
+  double m_minTime{0.2};
+  int m_repetitions{3};
+  std::vector<Result> m_results;
+};
+} // namespace neonet::bench
+#endif // BENCHMARK_H_
@@ -0,0 +1,111 @@
+/**
+ * @file BufferBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief Buffer的append/retrieve和readFd
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "Benchmark.h"
+#include "net/Buffer.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+using namespace neonet;
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  std::vector<char> data(1024 * 1024, 'x');
+
+  // 追加后立即取出，缓冲区不增长
+  for (size_t size : {16, 256, 4096, 65536}) {
+    runner.run(
+        "Buffer/append_retrieve/" + std::to_string(size),
+        [&data, size](uint64_t iterations) {
+          Buffer buf;
+          for (uint64_t i = 0; i < iterations; ++i) {
+            buf.append(data.data(), size);
+            bench::doNotOptimize(*buf.peek());
+            buf.retrieve(size);
+          }
+        },
+        size);
+  }
+
+  // 积累64条消息再整体取出，包含缓冲区的增长和前移
+  for (size_t size : {16, 256, 4096}) {
+    runner.run(
+        "Buffer/append_batch64/" + std::to_string(size),
+        [&data, size](uint64_t iterations) {
+          Buffer buf;
+          for (uint64_t i = 0; i < iterations; ++i) {
+            buf.append(data.data(), size);
+            if (i % 64 == 63) {
+              buf.retrieveAll();
+            }
+          }
+        },
+        size);
+  }
+
+  // 移走存储之后的Buffer仍然可以取出和写入，即send(Buffer*)之后的用法
+  bool movedFromUsable = true;
+  runner.run(
+      "Buffer/move_retrieve_append/256",
+      [&data, &movedFromUsable](uint64_t iterations) {
+        Buffer buf;
+        for (uint64_t i = 0; i < iterations; ++i) {
+          buf.append(data.data(), 256);
+          Buffer taken(std::move(buf));
+          bench::doNotOptimize(*taken.peek());
+          buf.retrieveAll();
+          if (buf.readableBytes() != 0 || buf.writableBytes() != 0) {
+            movedFromUsable = false;
+          }
+        }
+      },
+      256);
+
+  // 每次操作：对端写入size字节，readFd全部读出；包含对端write的开销
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) < 0) {
+    return 1;
+  }
+  for (size_t size : {64, 4096, 65536}) {
+    runner.run(
+        "Buffer/readFd/" + std::to_string(size),
+        [&data, &fds, size](uint64_t iterations) {
+          Buffer buf;
+          int savedErrno = 0;
+          for (uint64_t i = 0; i < iterations; ++i) {
+            size_t sent = 0;
+            while (sent < size) {
+              ssize_t n = ::write(fds[0], data.data() + sent, size - sent);
+              if (n > 0) {
+                sent += static_cast<size_t>(n);
+              }
+              buf.readFd(fds[1], &savedErrno);
+            }
+            while (buf.readableBytes() < size) {
+              buf.readFd(fds[1], &savedErrno);
+            }
+            buf.retrieveAll();
+          }
+        },
+        size);
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  runner.report();
+  if (!movedFromUsable) {
+    ::fprintf(stderr, "moved-from Buffer has invalid indices\n");
+    return 1;
+  }
+  return 0;
+}
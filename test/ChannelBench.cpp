@@ -0,0 +1,72 @@
+/**
+ * @file ChannelBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 每个就绪事件的分发开销(poll、Channel::handleEvent和回调)
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * @details
+ * n个eventfd的计数不清零，水平触发下每次poll都返回全部n个Channel，
+ * 每次操作是一次回调，poll的开销由n个事件分摊
+ *
+ */
+#include "Benchmark.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+using namespace neonet;
+
+namespace {
+void benchDispatch(bench::Runner &runner, Poller::Backend backend,
+                   const char *backendName, int channels) {
+  EventLoop loop(backend);
+  uint64_t count = 0;
+  uint64_t target = 0;
+  std::vector<int> fds;
+  std::vector<std::unique_ptr<Channel>> list;
+  for (int i = 0; i < channels; ++i) {
+    int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    fds.push_back(fd);
+    list.emplace_back(new Channel(&loop, fd));
+    list.back()->setReadCallback([&loop, &count, &target]() {
+      if (++count == target) {
+        loop.quit();
+      }
+    });
+    list.back()->enableReading();
+  }
+
+  runner.run(std::string("Channel/dispatch/") + backendName +
+                 "/channels:" + std::to_string(channels),
+             [&loop, &count, &target](uint64_t iterations) {
+               count = 0;
+               target = iterations;
+               loop.loop();
+             });
+
+  for (size_t i = 0; i < list.size(); ++i) {
+    list[i]->disableAll();
+    list[i]->remove();
+    ::close(fds[i]);
+  }
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  for (int channels : {1, 16, 256}) {
+    benchDispatch(runner, Poller::kEpoll, "epoll", channels);
+  }
+  for (int channels : {1, 16, 256}) {
+    benchDispatch(runner, Poller::kIoUring, "io_uring", channels);
+  }
+  runner.report();
+  return 0;
+}
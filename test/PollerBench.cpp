@@ -0,0 +1,56 @@
+/**
+ * @file PollerBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief EPoller::updateChannel的add/mod/del开销，每次操作是一次epoll_ctl
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "Benchmark.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+using namespace neonet;
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  // 不运行loop，在创建它的线程中直接调用Channel的接口
+  EventLoop loop(Poller::kEpoll);
+  int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  Channel channel(&loop, fd);
+
+  // 交替ADD和DEL
+  runner.run("EPoller/updateChannel/add_del", [&channel](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      if (i % 2 == 0) {
+        channel.enableReading();
+      } else {
+        channel.disableAll();
+      }
+    }
+    channel.disableAll();
+  });
+
+  // 交替打开和关闭写事件，都是MOD
+  channel.enableReading();
+  runner.run("EPoller/updateChannel/mod", [&channel](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      if (i % 2 == 0) {
+        channel.enableWriting();
+      } else {
+        channel.disableWriting();
+      }
+    }
+    channel.disableWriting();
+  });
+
+  channel.disableAll();
+  channel.remove();
+  ::close(fd);
+  runner.report();
+  return 0;
+}
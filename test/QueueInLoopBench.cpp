@@ -0,0 +1,86 @@
+/**
+ * @file QueueInLoopBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 1..N个生产者线程向同一个loop投递任务的吞吐量
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "Benchmark.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace neonet;
+
+namespace {
+/**
+ * @brief loop线程中的计数，执行完target个任务后通知
+ *
+ */
+struct Consumer {
+  uint64_t count{0};
+  uint64_t target{0};
+  std::promise<void> done;
+};
+
+void consume(Consumer *c) {
+  if (++c->count == c->target) {
+    c->done.set_value();
+  }
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  EventLoopThread thread;
+  EventLoop *loop = thread.startLoop();
+
+  unsigned maxProducers = std::max(2u, std::thread::hardware_concurrency());
+  for (unsigned producers = 1; producers <= maxProducers; producers *= 2) {
+    runner.run(
+        "EventLoop/queueInLoop/producers:" + std::to_string(producers),
+        [loop, producers](uint64_t iterations) {
+          Consumer consumer;
+          consumer.target = iterations;
+          std::future<void> done = consumer.done.get_future();
+          std::vector<std::thread> threads;
+          for (unsigned i = 0; i < producers; ++i) {
+            uint64_t count = iterations / producers +
+                             (i == 0 ? iterations % producers : 0);
+            threads.emplace_back([loop, count, &consumer]() {
+              Consumer *c = &consumer;
+              for (uint64_t k = 0; k < count; ++k) {
+                loop->queueInLoop([c]() { consume(c); });
+              }
+            });
+          }
+          for (std::thread &t : threads) {
+            t.join();
+          }
+          done.wait();
+        });
+  }
+
+  // 对照：loop线程自己投递，不需要唤醒
+  runner.run("EventLoop/queueInLoop/same_thread", [loop](uint64_t iterations) {
+    Consumer consumer;
+    consumer.target = iterations;
+    std::future<void> done = consumer.done.get_future();
+    Consumer *c = &consumer;
+    loop->runInLoop([loop, c, iterations]() {
+      for (uint64_t k = 0; k < iterations; ++k) {
+        loop->queueInLoop([c]() { consume(c); });
+      }
+    });
+    done.wait();
+  });
+
+  runner.report();
+  return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file SlabBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief 连接大小的对象用make_shared和slab上的allocate_shared分配的开销，
+ * 以及TcpServer建立和关闭连接时slab的释放是否都发生在所属线程
+ * @version 0.1
+ * @date 2024-08-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "Benchmark.h"
+#include "base/Logging.h"
+#include "base/SlabPool.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/NetAddress.h"
+#include "net/TCPConnection.h"
+#include "net/TcpServer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace neonet;
+
+namespace {
+// 与TCPConnection同样大小的对象，只衡量分配本身
+struct Payload {
+  char bytes[sizeof(TCPConnection)];
+};
+inline constexpr const size_t kBatch{256}; // 同时存活的对象数
+inline constexpr const int kServerPort{29871};
+inline constexpr const int kServerThreads{2};
+inline constexpr const int kDrainWaitRounds{500}; // 每轮10ms
+
+/**
+ * @brief 在后台线程中运行的TcpServer，记录接受连接的loop和各工作loop的连接slab
+ *
+ */
+class ChurnServer {
+public:
+  ChurnServer() {
+    std::promise<void> ready;
+    m_thread = std::thread([this, &ready]() {
+      EventLoop loop;
+      TcpServer server(&loop, NetAddress("127.0.0.1", kServerPort),
+                       "SlabBench");
+      server.setThreadNum(kServerThreads);
+      server.setConnectionCallback([this](const TcpConnectionPtr &conn) {
+        if (conn->disconnected()) {
+          m_closed.fetch_add(1, std::memory_order_relaxed);
+        }
+      });
+      server.start();
+      m_slabs.push_back(loop.connectionSlab());
+      for (EventLoop *ioLoop : server.threadPool()->getAllLoops()) {
+        m_slabs.push_back(ioLoop->connectionSlab());
+      }
+      m_loop = &loop;
+      ready.set_value();
+      loop.loop();
+    });
+    ready.get_future().wait();
+  }
+  ~ChurnServer() {
+    m_loop->queueInLoop([loop = m_loop]() { loop->quit(); });
+    m_thread.join();
+  }
+
+  /**
+   * @brief 建立一个连接后立即用RST关闭，客户端不留下TIME_WAIT
+   *
+   */
+  void connectAndReset() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    NetAddress addr("127.0.0.1", kServerPort);
+    const struct sockaddr_in &sa = addr.getAddr();
+    if (::connect(fd, reinterpret_cast<const struct sockaddr *>(&sa),
+                  sizeof sa) == 0) {
+      ++m_opened;
+    }
+    struct linger lg{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+    ::close(fd);
+  }
+
+  /**
+   * @brief 等待服务器销毁所有连接，返回各slab远程释放次数之和
+   *
+   */
+  uint64_t drainAndCountRemoteFrees() {
+    for (int i = 0; i < kDrainWaitRounds && !drained(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    uint64_t remote = 0;
+    for (const auto &slab : m_slabs) {
+      remote += slab->remoteFrees();
+    }
+    return remote;
+  }
+
+private:
+  bool drained() const {
+    if (m_closed.load(std::memory_order_relaxed) < m_opened) {
+      return false;
+    }
+    for (const auto &slab : m_slabs) {
+      if (slab->inUse() != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::thread m_thread;
+  EventLoop *m_loop{nullptr};
+  std::vector<std::shared_ptr<SlabPool>> m_slabs;
+  std::atomic<uint64_t> m_closed{0};
+  uint64_t m_opened{0}; // 只在主线程访问
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  auto slab = std::make_shared<SlabPool>(sizeof(Payload) + 64);
+  std::vector<std::shared_ptr<Payload>> live;
+  live.reserve(kBatch);
+
+  // 每次操作：创建一个对象；每kBatch个对象整体释放一次
+  runner.run("Slab/make_shared", [&live](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      live.push_back(std::make_shared<Payload>());
+      if (live.size() == kBatch) {
+        live.clear();
+      }
+    }
+    live.clear();
+  });
+  runner.run("Slab/allocate_shared", [&live, &slab](uint64_t iterations) {
+    SlabAllocator<Payload> alloc(slab);
+    for (uint64_t i = 0; i < iterations; ++i) {
+      live.push_back(std::allocate_shared<Payload>(alloc));
+      if (live.size() == kBatch) {
+        live.clear();
+      }
+    }
+    live.clear();
+  });
+
+  // 同上，但由另一个线程释放，模拟连接在其他loop上销毁
+  auto releaseRemotely = [&live]() {
+    std::thread([batch = std::move(live)]() mutable { batch.clear(); })
+        .join();
+    live.clear();
+    live.reserve(kBatch);
+  };
+  runner.run("Slab/make_shared_remote_free",
+             [&live, &releaseRemotely](uint64_t iterations) {
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 live.push_back(std::make_shared<Payload>());
+                 if (live.size() == kBatch) {
+                   releaseRemotely();
+                 }
+               }
+               releaseRemotely();
+             });
+  runner.run("Slab/allocate_shared_remote_free",
+             [&live, &slab, &releaseRemotely](uint64_t iterations) {
+               SlabAllocator<Payload> alloc(slab);
+               for (uint64_t i = 0; i < iterations; ++i) {
+                 live.push_back(std::allocate_shared<Payload>(alloc));
+                 if (live.size() == kBatch) {
+                   releaseRemotely();
+                 }
+               }
+               releaseRemotely();
+             });
+
+  // 每次操作：建立并关闭一个连接；连接在工作loop中分配和释放，
+  // 不应经过slab的远程空闲栈。RST会让服务器为每个连接记一条ERROR日志，
+  // 日志默认写到stdout，会混进JSON结果
+  Logger::setLogLevel(Logger::FATAL);
+  ChurnServer server;
+  runner.run("Slab/server_connect_reset", [&server](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      server.connectAndReset();
+    }
+  });
+  uint64_t remoteFrees = server.drainAndCountRemoteFrees();
+  runner.report();
+  if (remoteFrees != 0) {
+    ::fprintf(stderr, "connection slabs saw %llu remote frees\n",
+              static_cast<unsigned long long>(remoteFrees));
+    return 1;
+  }
+  return 0;
+}
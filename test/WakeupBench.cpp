@@ -0,0 +1,63 @@
+/**
+ * @file WakeupBench.cpp
+ * @author lzy (lzy_cs_LN@163.com)
+ * @brief EventLoop跨线程唤醒的往返延迟和eventfd写入的开销
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "Benchmark.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include <cstdint>
+#include <future>
+using namespace neonet;
+
+namespace {
+/**
+ * @brief 两个loop之间来回投递任务，每一跳都要唤醒阻塞在poll中的对方
+ *
+ */
+struct PingPong {
+  EventLoop *a;
+  EventLoop *b;
+  uint64_t remaining;
+  std::promise<void> done;
+};
+
+void pingA(PingPong *p) {
+  if (--p->remaining == 0) {
+    p->done.set_value();
+    return;
+  }
+  p->b->queueInLoop([p]() { p->a->queueInLoop([p]() { pingA(p); }); });
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bench::Runner runner(argc, argv);
+  EventLoopThread threadA;
+  EventLoopThread threadB;
+  EventLoop *a = threadA.startLoop();
+  EventLoop *b = threadB.startLoop();
+
+  // 一次往返：a -> b -> a，两次queueInLoop和两次唤醒
+  runner.run("EventLoop/wakeup/round_trip", [a, b](uint64_t iterations) {
+    PingPong p{a, b, iterations + 1, {}};
+    std::future<void> done = p.done.get_future();
+    a->queueInLoop([&p]() { pingA(&p); });
+    done.wait();
+  });
+
+  // 只测其他线程写eventfd的开销，loop线程同时在读取
+  runner.run("EventLoop/wakeup/write", [b](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      b->wakeup();
+    }
+  });
+
+  runner.report();
+  return 0;
+}